@@ -19,9 +19,9 @@ Checksum::Checksum()
 	}
 }
 
-DWORD Checksum::CRC32(UCHAR* buf, size_t len)
+DWORD Checksum::CRC32(UCHAR* buf, size_t len, DWORD crc)
 {
-	DWORD c = 0xFFFFFFFF;
+	DWORD c = crc ^ 0xFFFFFFFF;
 	for (size_t i = 0; i < len; i++)
 		c = crc_table[(c ^ buf[i]) & 0xFF] ^ (c >> 8);
 
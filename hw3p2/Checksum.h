@@ -12,5 +12,7 @@ class Checksum
 public:
 	Checksum();
 
-	DWORD CRC32(UCHAR* buf, size_t len);
+	/* Returns the CRC-32 of 'buf'. Passing the result for previous data as 'crc'
+	 * continues the checksum across calls. */
+	DWORD CRC32(UCHAR* buf, size_t len, DWORD crc = 0);
 };
\ No newline at end of file
@@ -16,6 +16,37 @@
 #define MAGIC_PROTOCOL    0x8311AA
 #define MAGIC_PORT        22345
 #define MAX_PKT_SIZE      (1500 - 28)
+#define RIO_SEND_SLOTS    16 // registered send buffers in the packet pool
+#define RIO_MAX_SEND_SLOTS 4096 // send pool limit when following the window
+#define RIO_RECV_DEPTH    8  // receives kept posted on the registered I/O queue
+
+// I/O backends selectable at runtime
+#define IO_SELECT         0 // sendto() and select()/recvfrom()
+#define IO_RIO            1 // Winsock registered I/O
+#define IO_SIM            2 // discrete-event simulation on a virtual clock
+
+// transport policies selectable at runtime, OR'd together, 0 picks the first of each
+#define CC_FIXED          0x0 // keep the window passed to ss.Open()
+#define CC_TUNED          0x1 // tune the window from the measured bandwidth-delay product
+#define RTO_MICROSECOND   0x2 // RFC 6298 on microsecond samples instead of Jacobson/Karels in ms
+#define CHECKSUM_CRC32    0x4 // CRC-32 data as it is framed and verify it against the FIN-ACK
+#define STATS_NONE        0x8 // no stats thread and no statistics in Properties
+
+// window autotuning
+#define AUTO_WINDOW       0 // sender window passed to ss.Open() to start from the link BDP
+#define TUNER_GAIN        2.0
+#define TUNER_MIN_WINDOW  1
+#define TUNER_MAX_WINDOW  65536
+
+// clock error allowance of MicrosecondRto (in usec)
+#define RTO_GRANULARITY   1000.0
+
+// ACK coalescing
+#define DEFAULT_ACK_DELAY 25000 // longest the receiver may hold an ACK (in usec)
+
+// multiplexed streams, streams with lower urgency are always scheduled first
+#define STREAM_DEFAULT_URGENCY 3
+#define STREAM_MAX_URGENCY     7
 
 // possible status codes from ss.Open(), ss.Send(), and ss.Close()
 #define STATUS_OK         0 // no error
@@ -25,5 +56,7 @@
 #define FAILED_SEND       4 // sendto() failed in kernel 
 #define TIMEOUT           5 // timeout after all retx attempts are exhausted
 #define FAILED_RECV       6 // recvfrom() failed in kernel
-#define INVALID_ARGUMENTS 7 // incorrect number of passed command line arguments
-#define FAST_RTX          8           
\ No newline at end of file
+#define INVALID_ARGUMENTS 7 // bad command line arguments or ss.Send() message size
+#define FAST_RTX          8
+#define INVALID_STREAM    9 // ss.Write() on a stream that was never opened or not accepted by the receiver
+#define BAD_CHECKSUM      10 // FIN-ACK checksum does not match the data sent (CHECKSUM_CRC32 only)
\ No newline at end of file
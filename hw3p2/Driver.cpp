@@ -9,6 +9,35 @@
 
 using namespace std;
 
+// print command line usage
+static VOID PrintUsage()
+{
+	printf("usage: hw3p1.exe <DSN> <PBS> <SWS> <RTT> <LPF> <LPR> <BLS> [options]\n");
+	printf("DSN - Destination server IP or hostname\n");
+	printf("PBS - Power of two size for transmission buffer (bytes)\n");
+	printf("SWS - Sender window size (1-%d packets), 'auto' to size it from the measured BDP\n", TUNER_MAX_WINDOW);
+	printf("RTT - Simulated RTT propogation delay (seconds)\n");
+	printf("LPF - Simulated loss probability in forward direction\n");
+	printf("LPR - Simulated loss probability in reverse direction\n");
+	printf("BLS - Bottleneck link speed (Mbps)\n");
+	printf("options:\n");
+	printf("-rio             - Use registered I/O for sends and ACKs (falls back to select)\n");
+	printf("-spin <usec>     - Low-latency mode, busy-poll for ACKs before blocking\n");
+	printf("-pin <core>      - Low-latency mode, pin the transport thread to a core\n");
+	printf("-statspin <core> - Pin the stats thread to a core (default: any but the I/O core)\n");
+	printf("-sim <seed>      - Simulate the path on a virtual clock instead of using the network\n");
+	printf("-runs <n>        - Repeat the transfer n times, one connection after another,\n");
+	printf("                   seeds seed..seed+n-1 with -sim\n");
+	printf("-ackevery <n>    - Ask the receiver to acknowledge only every n packets\n");
+	printf("-ackdelay <usec> - Longest the receiver may hold an ACK (default: %d)\n", DEFAULT_ACK_DELAY);
+	printf("-streams <n>     - Split the buffer over n streams multiplexed on one connection\n");
+	printf("-prio            - Schedule lower numbered streams first instead of round robin\n");
+	printf("-passes <n>      - Send the buffer n times over one connection\n");
+	printf("-microrto        - Estimate the RTO from microsecond RTT samples (RFC 6298)\n");
+	printf("-nostats         - Do not run the stats thread or collect statistics\n");
+	printf("-checksum        - Checksum data as it is sent and fail if the receiver disagrees\n");
+}
+
 int main(INT argc, CHAR** argv)
 {
 	// debug flag to check for memory leaks
@@ -16,30 +45,142 @@ int main(INT argc, CHAR** argv)
 
 	// ************* VALIDATE ARGUMENTS ************** //
 
-	if (argc != 8)
+	if (argc < 8)
 	{
-		(argc < 8) ? printf("error: too few arguments\n\n") : printf("error: too many arguments\n\n");
-		printf("usage: hw3p1.exe <DSN> <PBS> <SWS> <RTT> <LPF> <LPR> <BLS>\n");
-		printf("DSN - Destination server IP or hostname\n");
-		printf("PBS - Power of two size for transmission buffer (bytes)\n");
-		printf("SWS - Sender window size (packets)\n");
-		printf("RTT - Simulated RTT propogation delay (seconds)\n");
-		printf("LPF - Simulated loss probability in forward direction\n");
-		printf("LPR - Simulated loss probability in reverse direction\n");
-		printf("BLS - Bottleneck link speed (Mbps)\n");
+		printf("error: too few arguments\n\n");
+		PrintUsage();
+		return INVALID_ARGUMENTS;
+	}
+
+	DWORD ioMode    = IO_SELECT;
+	BOOL lowLatency = false;
+	LONG spinBudget = 0;
+	INT ioCore      = -1;
+	INT statsCore   = -1;
+	DWORD simSeed   = 0;
+	DWORD runs      = 1;
+	DWORD ackEvery  = 1;
+	DWORD ackDelay  = DEFAULT_ACK_DELAY;
+	DWORD numStreams = 1;
+	BOOL prioritized = false;
+	DWORD passes     = 1;
+	DWORD policies   = CC_FIXED;
+	for (INT i = 8; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-rio") == 0)
+			ioMode = IO_RIO;
+		else if (strcmp(argv[i], "-spin") == 0 && i + 1 < argc)
+		{
+			spinBudget = atoi(argv[++i]);
+			lowLatency = true;
+		}
+		else if (strcmp(argv[i], "-pin") == 0 && i + 1 < argc)
+		{
+			ioCore = atoi(argv[++i]);
+			if (Transport::CoreMask(ioCore) == 0)
+			{
+				printf("error: core %s is not available to this process\n\n", argv[i]);
+				PrintUsage();
+				return INVALID_ARGUMENTS;
+			}
+			lowLatency = true;
+		}
+		else if (strcmp(argv[i], "-statspin") == 0 && i + 1 < argc)
+		{
+			statsCore = atoi(argv[++i]);
+			if (Transport::CoreMask(statsCore) == 0)
+			{
+				printf("error: core %s is not available to this process\n\n", argv[i]);
+				PrintUsage();
+				return INVALID_ARGUMENTS;
+			}
+		}
+		else if (strcmp(argv[i], "-sim") == 0 && i + 1 < argc)
+		{
+			simSeed = atoi(argv[++i]);
+			ioMode = IO_SIM;
+		}
+		else if (strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+		{
+			runs = atoi(argv[++i]);
+			runs = max(runs, 1);
+		}
+		else if (strcmp(argv[i], "-ackevery") == 0 && i + 1 < argc)
+		{
+			ackEvery = atoi(argv[++i]);
+			ackEvery = max(ackEvery, 1);
+		}
+		else if (strcmp(argv[i], "-ackdelay") == 0 && i + 1 < argc)
+			ackDelay = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-streams") == 0 && i + 1 < argc)
+		{
+			numStreams = atoi(argv[++i]);
+			numStreams = min(max(numStreams, 1), MAXWORD + 1);
+		}
+		else if (strcmp(argv[i], "-prio") == 0)
+			prioritized = true;
+		else if (strcmp(argv[i], "-passes") == 0 && i + 1 < argc)
+		{
+			passes = atoi(argv[++i]);
+			passes = max(passes, 1);
+		}
+		else if (strcmp(argv[i], "-microrto") == 0)
+			policies |= RTO_MICROSECOND;
+		else if (strcmp(argv[i], "-nostats") == 0)
+			policies |= STATS_NONE;
+		else if (strcmp(argv[i], "-checksum") == 0)
+			policies |= CHECKSUM_CRC32;
+		else
+		{
+			printf("error: unknown option %s\n\n", argv[i]);
+			PrintUsage();
+			return INVALID_ARGUMENTS;
+		}
+	}
+
+	if (ioCore >= 0 && ioCore == statsCore)
+	{
+		printf("error: the stats thread cannot share the I/O core\n\n");
+		PrintUsage();
 		return INVALID_ARGUMENTS;
 	}
 
 	// ************ INITIALIZE VARIABLES ************* //
 	
 	CHAR* destination     = argv[1];
-	DWORD dwordBufSize    = (DWORD) 1 << atoi(argv[2]); // Can't use UINT64 because allocation with new uses unsigned 32 bit int
-	DWORD senderWindow    = atoi(argv[3]);
+	INT bufferPower       = atoi(argv[2]);
+	DWORD senderWindow    = AUTO_WINDOW;
 	FLOAT RTT             = (FLOAT) atof(argv[4]);
 	FLOAT fLossProb       = (FLOAT) atof(argv[5]);
 	FLOAT rLossProb       = (FLOAT) atof(argv[6]);
 	DWORD bottleneckSpeed = atoi(argv[7]);
 
+	// a literal 0 would silently mean auto and a negative window would wrap around
+	if (strcmp(argv[3], "auto") != 0)
+	{
+		CHAR* end = NULL;
+		LONG window = strtol(argv[3], &end, 10);
+		if (end == argv[3] || *end != '\0' || window < 1 || window > TUNER_MAX_WINDOW)
+		{
+			printf("error: sender window must be 'auto' or 1 to %d packets\n\n", TUNER_MAX_WINDOW);
+			PrintUsage();
+			return INVALID_ARGUMENTS;
+		}
+		senderWindow = (DWORD) window;
+	}
+
+	if (senderWindow == AUTO_WINDOW)
+		policies |= CC_TUNED;
+
+	// the buffer has to fit in the address space, 2^30 elements and up only on 64-bit builds
+	if (bufferPower < 0 || bufferPower > 61 || ((UINT64) 1 << bufferPower) > SIZE_MAX / sizeof(DWORD))
+	{
+		printf("error: a buffer of 2^%d elements does not fit in memory\n\n", bufferPower);
+		PrintUsage();
+		return INVALID_ARGUMENTS;
+	}
+	UINT64 dwordBufSize   = (UINT64) 1 << bufferPower;
+
 	chrono::time_point<chrono::high_resolution_clock> startTime, stopTime;
 
 	STRUCT LinkProperties lp;
@@ -48,87 +189,198 @@ int main(INT argc, CHAR** argv)
 	lp.pLoss[0] = fLossProb;
 	lp.pLoss[1] = rLossProb;
 
-	printf("Main:   sender W = %d, RTT = %.3f sec, loss %g / %g, link %d Mbps\n" , senderWindow, RTT, fLossProb, rLossProb, bottleneckSpeed);
+	printf("Main:   sender W = %s, RTT = %.3f sec, loss %g / %g, link %d Mbps\n" , (senderWindow == AUTO_WINDOW) ? "auto" : argv[3], RTT, fLossProb, rLossProb, bottleneckSpeed);
 	
 	// ************* TIMED FILL OF BUFFER ************ //
 	
-	printf("Main:   initializing DWORD array with 2^%d elements... ", atoi(argv[2]));
+	printf("Main:   initializing DWORD array with 2^%d elements... ", bufferPower);
 	startTime = chrono::high_resolution_clock::now();
 
-	DWORD* dwordBuf = new DWORD[dwordBufSize];
-	for (DWORD i = 0; i < dwordBufSize; i++)
-		dwordBuf[i] = i;
+	DWORD* dwordBuf = new DWORD[(size_t) dwordBufSize];
+	for (UINT64 i = 0; i < dwordBufSize; i++)
+		dwordBuf[i] = (DWORD) i;
 
 	stopTime = chrono::high_resolution_clock::now();
 	printf("done in %lld ms\n",
 		chrono::duration_cast<chrono::milliseconds>
 		(stopTime - startTime).count());
 
-	// ********** OPEN CONNECTION TO SERVER ********** //
-	
-	INT status = -1;
-	Properties p;
-	SenderSocket socket(&p);
+	UINT64 charBufSize = (UINT64) dwordBufSize << 2;
+	CHAR* charBuf = (CHAR*)dwordBuf;
+	DOUBLE totalRate = 0.0;
 
-	startTime = chrono::high_resolution_clock::now();
-	if ((status = socket.Open(destination, MAGIC_PORT, senderWindow, &lp)) != STATUS_OK)
+	// with several streams each one carries a contiguous part of the buffer
+	UINT64 partSize = (charBufSize + numStreams - 1) / numStreams;
+	BOOL multiplexed = false;
+
+	for (DWORD run = 0; run < runs; run++)
 	{
-		printf("Main:   open failed with status %d\n", status);
-		delete[] dwordBuf;
-		return status;
-	}
-	stopTime = chrono::high_resolution_clock::now();
+		if (runs > 1)
+			printf("Main:   run %d of %d, seed %d\n", run + 1, runs, simSeed + run);
 
-	printf("Main:   connected to %s in %0.3f sec, pkt size %d bytes\n", destination, 
-		chrono::duration_cast<chrono::milliseconds>
-		(stopTime - startTime).count() / 1000.0, MAX_PKT_SIZE);
+		// ********** OPEN CONNECTION TO SERVER ********** //
+
+		INT status = -1;
+		Properties p;
+		SenderSocket socket(&p, ioMode, simSeed + run, policies);
+		if (lowLatency)
+		{
+			socket.SetLowLatency(spinBudget, ioCore, statsCore);
+			printf("Main:   low-latency mode, spin %d us, I/O core %d, stats core %d\n", spinBudget, ioCore, statsCore);
+		}
+		else if (statsCore >= 0)
+		{
+			socket.PinStats(statsCore);
+			printf("Main:   stats thread pinned to core %d\n", statsCore);
+		}
+		if (ackEvery > 1)
+			socket.SetAckFrequency(ackEvery, ackDelay);
+
+		// stream 0 always exists and has the default urgency
+		for (DWORD i = 1; i < numStreams; i++)
+		{
+			DWORD streamId = 0;
+			if ((status = socket.OpenStream(streamId, prioritized ? STREAM_DEFAULT_URGENCY + i : STREAM_DEFAULT_URGENCY)) != STATUS_OK)
+			{
+				printf("Main:   could not open stream %d (status %d), sending on one stream\n", i, status);
+				numStreams = 1;
+				partSize = charBufSize;
+			}
+		}
+
+		// simulated transfers are timed on the virtual clock
+		chrono::time_point<chrono::high_resolution_clock> wallStartTime = chrono::high_resolution_clock::now();
+		startTime = socket.Now();
+		if ((status = socket.Open(destination, MAGIC_PORT, senderWindow, &lp)) != STATUS_OK)
+		{
+			printf("Main:   open failed with status %d\n", status);
+			delete[] dwordBuf;
+			return status;
+		}
+		stopTime = socket.Now();
+
+		printf("Main:   connected to %s in %0.3f sec, pkt size %d bytes, %s I/O\n", destination, 
+			chrono::duration_cast<chrono::milliseconds>
+			(stopTime - startTime).count() / 1000.0, MAX_PKT_SIZE, socket.IOName());
+
+		// a receiver that does not accept streams gets the whole buffer in order on stream 0
+		multiplexed = socket.Multiplexed();
+		if (numStreams > 1 && !multiplexed)
+		{
+			printf("Main:   receiver does not support streams, sending on one stream\n");
+			numStreams = 1;
+			partSize = charBufSize;
+		}
 	
-	startTime = chrono::high_resolution_clock::now();
+		startTime = socket.Now();
 
-	// ************* SEND DATA TO SERVER ************* //
+		// ************* SEND DATA TO SERVER ************* //
 
-	UINT64 charBufSize = (UINT64) dwordBufSize << 2;
-	CHAR* charBuf = (CHAR*)dwordBuf;
-	UINT64 offset = 0;
-	UINT numPackets = 0;
+		// with -passes the buffer is sent again and again, the receiver sees one long stream of data
+		UINT64 totalBytes = charBufSize * passes;
+		UINT64 offset = 0;
+		UINT64 numPackets = 0;
+
+		if (numStreams > 1)
+		{
+			// streams are written whole and scheduled by the socket
+			for (DWORD pass = 0; pass < passes; pass++)
+			{
+				for (DWORD i = 0; i < numStreams; i++)
+				{
+					UINT64 start = min(i * partSize, charBufSize);
+					if ((status = socket.Write(i, charBuf + start, min(start + partSize, charBufSize) - start)) != STATUS_OK)
+					{
+						printf("Main:   send failed with status %d\n", status);
+						delete[] dwordBuf;
+						return status;
+					}
+				}
+			}
+			offset = totalBytes;
+		}
 	
-	while (offset < charBufSize)
-	{
-		// decide the size of the next chunk
-		UINT64 bytes = min(charBufSize - offset, (MAX_PKT_SIZE - sizeof(SenderDataHeader)));
-		// send chunk into socket
-		//cout << "DEBUG: Main sending " << bytes << " bytes\n";
-		if ((status = socket.Send(charBuf + offset, bytes)) != STATUS_OK)
+		while (offset < totalBytes)
+		{
+			// decide the size of the next chunk, chunks do not straddle two passes
+			UINT64 position = offset % charBufSize;
+			UINT64 bytes = min(charBufSize - position, (UINT64) socket.MaxPayload());
+			// send chunk into socket
+			//cout << "DEBUG: Main sending " << bytes << " bytes\n";
+			if ((status = socket.Send(charBuf + position, (INT) bytes)) != STATUS_OK)
+			{
+				printf("Main:   send failed with status %d\n", status);
+				delete[] dwordBuf;
+				return status;
+			}
+
+			numPackets++;
+			offset += bytes;
+		}
+
+		// the transfer ends when the last packet in flight is acknowledged
+		if ((status = socket.Flush()) != STATUS_OK)
 		{
 			printf("Main:   send failed with status %d\n", status);
 			delete[] dwordBuf;
 			return status;
 		}
-
-		numPackets++;
-		offset += bytes;
-	}
 	
-	stopTime = chrono::high_resolution_clock::now();
+		stopTime = socket.Now();
+
+		for (DWORD i = 0; numStreams > 1 && i < numStreams; i++)
+			printf("Main:   stream %d finished in %0.3f sec\n", i,
+				chrono::duration_cast<chrono::microseconds>
+				(socket.StreamFinished(i) - startTime).count() / 1000000.0);
 	
-	// ********** CLOSE CONNECTION TO SERVER ********* //
+		// ********** CLOSE CONNECTION TO SERVER ********* //
 	
-	DOUBLE elapsedTime = 0.0;
-	if ((status = socket.Close(elapsedTime)) != STATUS_OK)
-	{
-		printf("Main:   close failed with status %d\n", status);
-		delete[] dwordBuf;
-		return status;
-	}
+		DOUBLE elapsedTime = 0.0;
+		if ((status = socket.Close(elapsedTime)) != STATUS_OK)
+		{
+			printf("Main:   close failed with status %d\n", status);
+			delete[] dwordBuf;
+			return status;
+		}
 
-	printf("Main:   transfer finished in %0.3f sec\n",
-		chrono::duration_cast<chrono::milliseconds>
-		(stopTime - startTime).count() / 1000.0);
+		DOUBLE transferTime = chrono::duration_cast<chrono::microseconds>(stopTime - startTime).count() / 1000000.0;
+		// everything written has been acknowledged by now, even without statistics
+		DOUBLE rate = (totalBytes * 8) / (1000.0 * transferTime);
+		totalRate += rate;
+		printf("Main:   transfer finished in %0.3f sec, %0.2f Kbps\n", transferTime, rate);
+		if (ioMode == IO_SIM)
+			printf("Main:   simulated %0.3f sec in %0.3f sec of wall-clock time\n", elapsedTime,
+				chrono::duration_cast<chrono::milliseconds>
+				(chrono::high_resolution_clock::now() - wallStartTime).count() / 1000.0);
+		if (p.rttSamples > 0)
+			printf("Main:   RTT avg %0.1f us, min %d us over %llu samples\n", (DOUBLE) p.rttSumMicros / p.rttSamples, p.minRTTMicros, p.rttSamples);
 
-	Checksum cs;
-	DWORD check = cs.CRC32((UCHAR*) charBuf, charBufSize);
-	printf("Main:   estRTT %0.3f, ideal rate %0.2f Kbps, checksum 0x%X\n", p.estRTT / 1000.0, ((UINT64) senderWindow * MAX_PKT_SIZE * 8) / (FLOAT) p.estRTT, check);
+		if (run == runs - 1)
+		{
+			// with multiplexing the receiver checks each stream, then the checksums in stream order
+			Checksum cs;
+			DWORD check = 0;
+			for (DWORD pass = 0; pass < passes; pass++)
+				check = cs.CRC32((UCHAR*) charBuf, charBufSize, check);
+			if (multiplexed)
+			{
+				check = 0;
+				for (UINT64 start = 0; start < charBufSize; start += partSize)
+				{
+					DWORD part = 0;
+					for (DWORD pass = 0; pass < passes; pass++)
+						part = cs.CRC32((UCHAR*) charBuf + start, min(partSize, charBufSize - start), part);
+					check = cs.CRC32((UCHAR*) &part, sizeof(part), check);
+				}
+			}
+			printf("Main:   estRTT %0.3f, ideal rate %0.2f Kbps, checksum 0x%X\n", p.estRTT / 1000.0,
+				(p.estRTT > 0) ? ((UINT64) p.windowSize * MAX_PKT_SIZE * 8) / (FLOAT) p.estRTT : 0.0, check);
+		}
+	}
+
+	if (runs > 1)
+		printf("Main:   average rate %0.2f Kbps over %d runs\n", totalRate / runs, runs);
 
 	delete[] dwordBuf;
 	return 0;
-}
+}
\ No newline at end of file
@@ -8,7 +8,10 @@
 #pragma pack(push, 1)
 struct Flags 
 {
-	DWORD reserved : 5; // must be 0
+	DWORD reserved : 2; // must be 0
+	DWORD     STRM : 1; // multiplexed streams requested (SYN), accepted (SYN-ACK) or ACK carries a stream window
+	DWORD   ACKNOW : 1; // data packet should be acknowledged without delay
+	DWORD     DACK : 1; // delayed ACKs requested (SYN), accepted (SYN-ACK) or ACK carries its delay
 	DWORD      SYN : 1;
 	DWORD      ACK : 1;
 	DWORD      FIN : 1;
@@ -31,7 +34,7 @@ struct LinkProperties
 struct SenderDataHeader
 {
 	Flags flags;
-	DWORD seq = 0;   // must begin from 0
+	DWORD seq = 0;   // must begin from 0, wraps around after 2^32 packets
 };
 
 struct SenderSynHeader 
@@ -40,27 +43,68 @@ struct SenderSynHeader
 	LinkProperties   lp;
 };
 
+struct AckFrequency
+{
+	DWORD ackEvery = 1; // ACK at least once every ackEvery in-order packets
+	DWORD maxDelay = 0; // longest the receiver may hold an ACK (in microseconds)
+};
+
+// SYN with the DACK flag set, asks the receiver to coalesce ACKs
+struct SenderDackSynHeader
+{
+	SenderSynHeader ssh;
+	AckFrequency    af;
+};
+
+// data header once multiplexed streams have been negotiated
+struct SenderStreamHeader
+{
+	SenderDataHeader sdh;
+	WORD  stream;    // stream ID, stream 0 always exists
+	DWORD streamSeq; // must begin from 0 on every stream
+};
+
 struct ReceiverHeader 
 {
 	Flags flags;
 	DWORD recvWnd; // reciever window for flow control (in packets)
-	DWORD ackSeq;  // ack value = next expected sequence
+	DWORD ackSeq;  // ack value = next expected sequence, wraps around like seq
+};
+
+// ACK sent once delayed ACKs have been negotiated
+struct ReceiverDackHeader
+{
+	ReceiverHeader rh;
+	DWORD ackDelay; // time the receiver held this ACK (in microseconds)
 };
 
+// ACK sent once multiplexed streams have been negotiated, ackDelay is only valid with DACK set
+struct ReceiverStreamHeader
+{
+	ReceiverDackHeader rdh;
+	WORD  stream;    // stream of the newest data packet
+	DWORD streamWnd; // reciever window for that stream (in packets)
+};
+#pragma pack(pop)
+
+// shared with the stats thread, not sent on the wire so the 64-bit counters stay aligned for Interlocked*64
 struct Properties
 {
 	CRITICAL_SECTION criticalSection;
 	std::chrono::time_point<std::chrono::high_resolution_clock> totalTime = std::chrono::high_resolution_clock::now();
-	HANDLE eventQuit      = CreateEvent(NULL, true, false, NULL);
-	DWORD goodput         = 0;
-	DWORD senderBase      = 0;
-	DWORD sequenceNum     = 0;
-	DWORD windowSize      = 0;
-	UINT64 bytesAcked     = 0;
-	DWORD timeoutPackets  = 0;
-	DWORD fastRetxPackets = 0;
-	INT estRTT            = 0;
-	INT devRTT            = 0;
+	HANDLE eventQuit       = CreateEvent(NULL, true, false, NULL);
+	UINT64 goodput         = 0;
+	UINT64 senderBase      = 0; // packets since the SYN, the sequence number on the wire is the low 32 bits
+	UINT64 sequenceNum     = 0;
+	DWORD windowSize       = 0;
+	UINT64 bytesAcked      = 0;
+	UINT64 timeoutPackets  = 0;
+	UINT64 fastRetxPackets = 0;
+	INT estRTT             = 0;
+	INT devRTT             = 0;
+	UINT64 rttSamples      = 0; // microsecond RTT samples for benchmark output
+	UINT64 rttSumMicros    = 0;
+	DWORD minRTTMicros     = MAXDWORD;
 
 	Properties() 
 	{ 
@@ -68,5 +112,4 @@ struct Properties
 		assert(eventQuit != NULL);
 	}
 	~Properties() { DeleteCriticalSection(&criticalSection); }
-};
-#pragma pack(pop)
\ No newline at end of file
+};
\ No newline at end of file
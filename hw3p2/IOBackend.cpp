@@ -0,0 +1,706 @@
+// IOBackend.cpp
+// CSCE 463-500
+// Luke Grammer
+// 11/12/19
+
+#include "pch.h"
+
+using namespace std;
+
+#define RIO_RECV_TAG 0x80000000 // marks receive completions in the request context
+
+// ******************** SELECT ******************** //
+
+SelectBackend::~SelectBackend()
+{
+	if (sock != INVALID_SOCKET)
+		closesocket(sock);
+}
+
+INT SelectBackend::Init()
+{
+	// open a UDP socket
+	sock = socket(AF_INET, SOCK_DGRAM, NULL);
+	if (sock == INVALID_SOCKET)
+	{
+		printf("\tsocket() generated error %d\n", WSAGetLastError());
+		return SOCKET_ERROR;
+	}
+
+	// Bind socket to local machine
+	struct sockaddr_in local;
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = INADDR_ANY;
+	local.sin_port = NULL;
+
+	if (bind(sock, (struct sockaddr*) &local, sizeof(local)) == SOCKET_ERROR)
+	{
+		printf("bind() generated error %d\n", WSAGetLastError());
+		return SOCKET_ERROR;
+	}
+
+	return STATUS_OK;
+}
+
+INT SelectBackend::Send(CONST CHAR* buf, INT len)
+{
+	return sendto(sock, buf, len, NULL, (STRUCT sockaddr*) &server, sizeof(server));
+}
+
+INT SelectBackend::Wait(LONG timeout)
+{
+	fd_set fd;
+	FD_ZERO(&fd);
+	FD_SET(sock, &fd);
+
+	// set timeout
+	STRUCT timeval tv;
+	tv.tv_sec = timeout / 1000000;
+	tv.tv_usec = timeout % 1000000;
+
+	return select(0, &fd, NULL, NULL, &tv);
+}
+
+INT SelectBackend::Receive(CHAR* buf, INT len, LONG timeout)
+{
+	INT result = 0;
+
+	// low-latency mode, poll with a zero timeout so the thread is never descheduled
+	if (spinBudget > 0)
+	{
+		chrono::time_point<chrono::high_resolution_clock> startTime = chrono::high_resolution_clock::now();
+		LONG spin = min(timeout, spinBudget);
+		LONG elapsed = 0;
+
+		do
+		{
+			result = Wait(0);
+			elapsed = (LONG) chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - startTime).count();
+		} while (result == 0 && elapsed < spin);
+
+		timeout -= elapsed;
+	}
+
+	if (result == 0 && timeout > 0)
+		result = Wait(timeout);
+
+	if (result <= 0)
+		return result;
+
+	// create address struct for responder
+	STRUCT sockaddr_in response_addr;
+	INT response_size = sizeof(response_addr);
+
+	return recvfrom(sock, buf, len, NULL, (STRUCT sockaddr*) &response_addr, &response_size);
+}
+
+// ***************** REGISTERED I/O **************** //
+
+RioBackend::~RioBackend()
+{
+	FreeSendPool();
+
+	if (recvBufferId != RIO_INVALID_BUFFERID)
+		rio.RIODeregisterBuffer(recvBufferId);
+
+	// closing the socket also releases the request queue
+	if (sock != INVALID_SOCKET)
+		closesocket(sock);
+
+	if (completionQueue != RIO_INVALID_CQ)
+		rio.RIOCloseCompletionQueue(completionQueue);
+
+	if (completionEvent != NULL)
+		CloseHandle(completionEvent);
+
+	if (recvPool != NULL)
+		VirtualFree(recvPool, 0, MEM_RELEASE);
+}
+
+INT RioBackend::Init()
+{
+	// registered I/O requires the socket to be created with WSA_FLAG_REGISTERED_IO
+	sock = WSASocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP, NULL, 0, WSA_FLAG_REGISTERED_IO);
+	if (sock == INVALID_SOCKET)
+		return SOCKET_ERROR;
+
+	struct sockaddr_in local;
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = INADDR_ANY;
+	local.sin_port = NULL;
+
+	if (bind(sock, (struct sockaddr*) &local, sizeof(local)) == SOCKET_ERROR)
+		return SOCKET_ERROR;
+
+	// look up the registered I/O function table
+	GUID functionTableId = WSAID_MULTIPLE_RIO;
+	DWORD bytes = 0;
+	if (WSAIoctl(sock, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &functionTableId, sizeof(GUID),
+		&rio, sizeof(rio), &bytes, NULL, NULL) == SOCKET_ERROR)
+		return SOCKET_ERROR;
+
+	// completions signal an auto-reset event once RIONotify() has armed the queue
+	if ((completionEvent = CreateEvent(NULL, false, false, NULL)) == NULL)
+		return SOCKET_ERROR;
+
+	RIO_NOTIFICATION_COMPLETION notification;
+	notification.Type = RIO_EVENT_COMPLETION;
+	notification.Event.EventHandle = completionEvent;
+	notification.Event.NotifyReset = TRUE;
+
+	completionQueue = rio.RIOCreateCompletionQueue(sendSlots + RIO_RECV_DEPTH, &notification);
+	if (completionQueue == RIO_INVALID_CQ)
+		return SOCKET_ERROR;
+
+	requestQueue = rio.RIOCreateRequestQueue(sock, RIO_RECV_DEPTH, 1, sendSlots, 1, completionQueue, completionQueue, NULL);
+	if (requestQueue == RIO_INVALID_RQ)
+		return SOCKET_ERROR;
+
+	// register one page-aligned region for the receive and address buffers
+	DWORD recvSize = AddrOffset() + sizeof(SOCKADDR_INET);
+	recvPool = (CHAR*) VirtualAlloc(NULL, recvSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (recvPool == NULL)
+		return SOCKET_ERROR;
+
+	recvBufferId = rio.RIORegisterBuffer(recvPool, recvSize);
+	if (recvBufferId == RIO_INVALID_BUFFERID)
+		return SOCKET_ERROR;
+
+	if (!AllocSendPool(sendSlots))
+		return SOCKET_ERROR;
+
+	// keep the receive side fully armed so ACKs never wait on a repost
+	for (DWORD i = 0; i < RIO_RECV_DEPTH; i++)
+	{
+		if (!PostReceive(i))
+			return SOCKET_ERROR;
+	}
+
+	return CommitReceives() ? STATUS_OK : SOCKET_ERROR;
+}
+
+VOID RioBackend::SetServer(CONST STRUCT sockaddr_in& destination)
+{
+	IOBackend::SetServer(destination);
+
+	// RIOSendEx() reads the remote address from registered memory
+	SOCKADDR_INET* address = (SOCKADDR_INET*) (recvPool + AddrOffset());
+	memset(address, 0, sizeof(SOCKADDR_INET));
+	address->Ipv4 = destination;
+}
+
+BOOL RioBackend::AllocSendPool(DWORD slots)
+{
+	// build the new pool first so a failure leaves the old one usable
+	CHAR* pool = (CHAR*) VirtualAlloc(NULL, slots * MAX_PKT_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (pool == NULL)
+		return FALSE;
+
+	RIO_BUFFERID bufferId = rio.RIORegisterBuffer(pool, slots * MAX_PKT_SIZE);
+	if (bufferId == RIO_INVALID_BUFFERID)
+	{
+		VirtualFree(pool, 0, MEM_RELEASE);
+		return FALSE;
+	}
+
+	FreeSendPool();
+
+	sendPool = pool;
+	sendBufferId = bufferId;
+	sendSlots = slots;
+	nextSend = 0;
+	slotBusy = new BOOLEAN[sendSlots];
+	memset(slotBusy, 0, sendSlots * sizeof(BOOLEAN));
+
+	return TRUE;
+}
+
+VOID RioBackend::FreeSendPool()
+{
+	if (sendBufferId != RIO_INVALID_BUFFERID)
+		rio.RIODeregisterBuffer(sendBufferId);
+
+	if (sendPool != NULL)
+		VirtualFree(sendPool, 0, MEM_RELEASE);
+
+	delete[] slotBusy;
+
+	sendBufferId = RIO_INVALID_BUFFERID;
+	sendPool = NULL;
+	slotBusy = NULL;
+}
+
+INT RioBackend::Resize(DWORD packets)
+{
+	// grow to the next power of two above the window, shrink once it is well below
+	DWORD slots = sendSlots;
+	while (slots < packets && slots < RIO_MAX_SEND_SLOTS)
+		slots <<= 1;
+	while (slots > RIO_SEND_SLOTS && packets < slots / 4)
+		slots >>= 1;
+
+	if (slots == sendSlots)
+		return STATUS_OK;
+
+	// the old pool can only be released once every send from it has completed
+	if (!CommitSends())
+		return SOCKET_ERROR;
+	for (DWORD i = 0; i < sendSlots; i++)
+	{
+		while (slotBusy[i])
+		{
+			if (Poll() == SOCKET_ERROR)
+				return SOCKET_ERROR;
+		}
+	}
+
+	// larger queues also fit the old pool, so grow them before the pool and shrink them after
+	DWORD oldSlots = sendSlots;
+	if (slots > oldSlots && (!rio.RIOResizeCompletionQueue(completionQueue, slots + RIO_RECV_DEPTH) ||
+		!rio.RIOResizeRequestQueue(requestQueue, RIO_RECV_DEPTH, slots)))
+	{
+		maxSlots = oldSlots;
+		return SOCKET_ERROR;
+	}
+
+	if (!AllocSendPool(slots))
+	{
+		maxSlots = oldSlots;
+		return SOCKET_ERROR;
+	}
+
+	// failing to shrink the queues only leaves some entries unused
+	if (slots < oldSlots)
+	{
+		rio.RIOResizeCompletionQueue(completionQueue, slots + RIO_RECV_DEPTH);
+		rio.RIOResizeRequestQueue(requestQueue, RIO_RECV_DEPTH, slots);
+	}
+
+	return STATUS_OK;
+}
+
+BOOL RioBackend::PostReceive(DWORD slot)
+{
+	RIO_BUF data;
+	data.BufferId = recvBufferId;
+	data.Offset = RecvOffset(slot);
+	data.Length = MAX_PKT_SIZE;
+
+	receivesDeferred = true;
+	return rio.RIOReceive(requestQueue, &data, 1, RIO_MSG_DEFER, (PVOID) (ULONG_PTR) (slot | RIO_RECV_TAG));
+}
+
+BOOL RioBackend::CommitSends()
+{
+	if (!sendsDeferred)
+		return TRUE;
+
+	sendsDeferred = false;
+	return rio.RIOSendEx(requestQueue, NULL, 0, NULL, NULL, NULL, NULL, RIO_MSG_COMMIT_ONLY, NULL);
+}
+
+BOOL RioBackend::CommitReceives()
+{
+	if (!receivesDeferred)
+		return TRUE;
+
+	receivesDeferred = false;
+	return rio.RIOReceive(requestQueue, NULL, 0, RIO_MSG_COMMIT_ONLY, NULL);
+}
+
+INT RioBackend::Poll()
+{
+	RIORESULT results[RIO_SEND_SLOTS + RIO_RECV_DEPTH];
+	ULONG count = rio.RIODequeueCompletion(completionQueue, results, RIO_SEND_SLOTS + RIO_RECV_DEPTH);
+	if (count == RIO_CORRUPT_CQ)
+		return SOCKET_ERROR;
+
+	// finish every completion in the batch before reporting a failure, otherwise the slots
+	// behind it would stay busy or unposted for good
+	LONG error = 0;
+	for (ULONG i = 0; i < count; i++)
+	{
+		DWORD context = (DWORD) results[i].RequestContext;
+		if (results[i].Status != 0 && error == 0)
+			error = results[i].Status;
+
+		if (context & RIO_RECV_TAG)
+		{
+			DWORD slot = context & ~RIO_RECV_TAG;
+			if (results[i].Status != 0)
+			{
+				// nothing usable was received, put the slot straight back on the queue
+				if (!PostReceive(slot) && error == 0)
+					error = WSAGetLastError();
+				continue;
+			}
+
+			received[slot] = results[i].BytesTransferred;
+			ready[(readyHead + readyCount) % RIO_RECV_DEPTH] = slot;
+			readyCount++;
+		}
+		else
+			slotBusy[context] = false;
+	}
+
+	if (error != 0)
+	{
+		WSASetLastError(error);
+		return SOCKET_ERROR;
+	}
+
+	return count;
+}
+
+INT RioBackend::Send(CONST CHAR* buf, INT len)
+{
+	// wait for the next slot to drain, sends complete within microseconds once committed
+	if (slotBusy[nextSend] && !CommitSends())
+		return SOCKET_ERROR;
+	while (slotBusy[nextSend])
+	{
+		if (Poll() == SOCKET_ERROR)
+			return SOCKET_ERROR;
+	}
+
+	DWORD slot = nextSend;
+	nextSend = (nextSend + 1) % sendSlots;
+
+	memcpy(sendPool + slot * MAX_PKT_SIZE, buf, len);
+
+	RIO_BUF data;
+	data.BufferId = sendBufferId;
+	data.Offset = slot * MAX_PKT_SIZE;
+	data.Length = len;
+
+	RIO_BUF address;
+	address.BufferId = recvBufferId;
+	address.Offset = AddrOffset();
+	address.Length = sizeof(SOCKADDR_INET);
+
+	// queued only, the burst goes out with the next Receive()
+	slotBusy[slot] = true;
+	if (!rio.RIOSendEx(requestQueue, &data, 1, NULL, &address, NULL, NULL, RIO_MSG_DEFER, (PVOID) (ULONG_PTR) slot))
+	{
+		slotBusy[slot] = false;
+		return SOCKET_ERROR;
+	}
+	sendsDeferred = true;
+
+	return len;
+}
+
+INT RioBackend::Receive(CHAR* buf, INT len, LONG timeout)
+{
+	// every send since the last call goes to the kernel at once, consumed receive slots
+	// are reposted together once none is left to hand out
+	if (!CommitSends())
+		return SOCKET_ERROR;
+	if (readyCount == 0 && !CommitReceives())
+		return SOCKET_ERROR;
+
+	if (readyCount == 0 && Poll() == SOCKET_ERROR)
+		return SOCKET_ERROR;
+
+	// low-latency mode, spin on the user-mode completion queue before arming the event
+	if (readyCount == 0 && spinBudget > 0)
+	{
+		chrono::time_point<chrono::high_resolution_clock> startTime = chrono::high_resolution_clock::now();
+		LONG spin = min(timeout, spinBudget);
+		LONG elapsed = 0;
+
+		do
+		{
+			YieldProcessor();
+			if (Poll() == SOCKET_ERROR)
+				return SOCKET_ERROR;
+			elapsed = (LONG) chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - startTime).count();
+		} while (readyCount == 0 && elapsed < spin);
+
+		timeout -= elapsed;
+	}
+
+	// nothing completed yet, arm the queue and block for at most the timeout
+	if (readyCount == 0)
+	{
+		if (timeout < 1000)
+			return 0;
+
+		// failed slots reposted by Poll() must reach the kernel before blocking
+		if (!CommitReceives())
+			return SOCKET_ERROR;
+
+		if (!notifyArmed)
+		{
+			INT result = rio.RIONotify(completionQueue);
+			if (result != NO_ERROR && result != WSAEALREADY)
+			{
+				WSASetLastError(result);
+				return SOCKET_ERROR;
+			}
+			notifyArmed = true;
+		}
+
+		DWORD result = WaitForSingleObject(completionEvent, timeout / 1000);
+		if (result == WAIT_TIMEOUT)
+			return 0;
+		if (result != WAIT_OBJECT_0)
+			return SOCKET_ERROR;
+
+		// woken by a send completion only, let the caller recompute its timeout
+		notifyArmed = false;
+		if (Poll() == SOCKET_ERROR)
+			return SOCKET_ERROR;
+		if (readyCount == 0)
+			return 0;
+	}
+
+	DWORD slot = ready[readyHead];
+	readyHead = (readyHead + 1) % RIO_RECV_DEPTH;
+	readyCount--;
+
+	// anything past 'len' is dropped like recvfrom() would
+	INT bytes = min(len, (INT) received[slot]);
+	memcpy(buf, recvPool + RecvOffset(slot), bytes);
+
+	if (!PostReceive(slot))
+		return SOCKET_ERROR;
+
+	return bytes;
+}
+
+// ******************* SIMULATION ****************** //
+
+chrono::time_point<chrono::high_resolution_clock> SimBackend::Now()
+{
+	return chrono::time_point<chrono::high_resolution_clock>(chrono::microseconds(now));
+}
+
+VOID SimBackend::Schedule(UINT64 time, EventType type, CONST CHAR* buf, INT len)
+{
+	Event e;
+	e.time = time;
+	e.order = nextOrder++;
+	e.type = type;
+	e.size = len;
+	memcpy(e.data, buf, len);
+
+	events.push(e);
+}
+
+INT SimBackend::Send(CONST CHAR* buf, INT len)
+{
+	// the SYN carries the path the real server would emulate
+	SenderDataHeader* header = (SenderDataHeader*) buf;
+	if (header->flags.SYN)
+		lp = ((SenderSynHeader*) buf)->lp;
+
+	if (Lose(lp.pLoss[FORWARD_PATH]))
+		return len;
+
+	// tail drop once the router buffer is full
+	while (!bottleneck.empty() && bottleneck.front() <= now)
+		bottleneck.pop_front();
+	if (!header->flags.SYN && bottleneck.size() >= max(lp.bufferSize, 1))
+		return len;
+
+	// serialize onto the bottleneck link behind anything already queued
+	UINT64 transmit = (lp.speed > 0) ? (UINT64) (len * 8 * 1000000.0 / lp.speed) : 0;
+	linkFree = max(linkFree, now) + transmit;
+	bottleneck.push_back(linkFree);
+
+	Schedule(linkFree + (UINT64) (lp.RTT * 500000), SIM_DATA, buf, len);
+	return len;
+}
+
+VOID SimBackend::SendAck(Flags flags, DWORD ackSeq, DWORD recvWnd)
+{
+	ReceiverStreamHeader ack;
+	ack.rdh.rh.flags = flags;
+	ack.rdh.rh.flags.ACK = 1;
+	ack.rdh.rh.flags.DACK = dack;
+	ack.rdh.rh.recvWnd = recvWnd;
+	ack.rdh.rh.ackSeq = ackSeq;
+	ack.rdh.ackDelay = (unacked > 0) ? (DWORD) (now - newestTime) : 0;
+
+	INT size = dack ? sizeof(ReceiverDackHeader) : sizeof(ReceiverHeader);
+	if (multiplexed && !flags.SYN && !flags.FIN)
+	{
+		std::map<WORD, StreamState>::iterator stream = streams.find(lastStream);
+		DWORD held = (stream != streams.end()) ? (DWORD) stream->second.pending.size() : 0;
+
+		ack.rdh.rh.flags.STRM = 1;
+		ack.stream = lastStream;
+		ack.streamWnd = (held < lp.bufferSize) ? lp.bufferSize - held : 0;
+		size = sizeof(ReceiverStreamHeader);
+	}
+
+	unacked = 0;
+	timerGen++;
+
+	if (Lose(lp.pLoss[RETURN_PATH]))
+		return;
+
+	Schedule(now + (UINT64) (lp.RTT * 500000), SIM_ACK, (CHAR*) &ack, size);
+}
+
+VOID SimBackend::DeliverStream(CONST Event& e)
+{
+	SenderDataHeader* header = (SenderDataHeader*) e.data;
+	WORD id = 0;
+	DWORD streamSeq = header->seq;
+	INT headerSize = sizeof(SenderDataHeader);
+
+	if (multiplexed)
+	{
+		SenderStreamHeader* streamHeader = (SenderStreamHeader*) e.data;
+		id = streamHeader->stream;
+		streamSeq = streamHeader->streamSeq;
+		headerSize = sizeof(SenderStreamHeader);
+	}
+
+	lastStream = id;
+	StreamState& stream = streams[id];
+	CONST CHAR* payload = e.data + headerSize;
+	if (streamSeq != stream.expectedSeq)
+	{
+		stream.pending[streamSeq].assign(payload, e.data + e.size);
+		return;
+	}
+
+	stream.crc = cs.CRC32((UCHAR*) payload, e.size - headerSize, stream.crc);
+	stream.expectedSeq++;
+
+	std::map<DWORD, std::vector<CHAR>>::iterator next;
+	while ((next = stream.pending.find(stream.expectedSeq)) != stream.pending.end())
+	{
+		stream.crc = cs.CRC32((UCHAR*) next->second.data(), next->second.size(), stream.crc);
+		stream.expectedSeq++;
+		stream.pending.erase(next);
+	}
+}
+
+VOID SimBackend::Deliver(CONST Event& e)
+{
+	SenderDataHeader* header = (SenderDataHeader*) e.data;
+	Flags flags;
+
+	if (header->flags.SYN)
+	{
+		// accept ACK coalescing and multiplexed streams if the sender asked for them
+		dack = header->flags.DACK && e.size >= sizeof(SenderDackSynHeader);
+		if (dack)
+			af = ((SenderDackSynHeader*) e.data)->af;
+		multiplexed = header->flags.STRM;
+
+		// a single stream is numbered by the connection sequence, multiplexed ones from 0
+		expectedSeq = header->seq;
+		outOfOrder.clear();
+		streams.clear();
+		lastStream = 0;
+		if (!multiplexed)
+			streams[0].expectedSeq = header->seq;
+		unacked = 0;
+
+		flags.SYN = 1;
+		flags.STRM = multiplexed;
+		SendAck(flags, header->seq, lp.bufferSize);
+		return;
+	}
+
+	if (header->flags.FIN)
+	{
+		// like the real server, the FIN-ACK window carries the checksum of the data, for
+		// multiplexed streams the checksum of the checksums of every stream in ID order
+		DWORD crc = 0;
+		if (multiplexed)
+		{
+			for (std::map<WORD, StreamState>::iterator stream = streams.begin(); stream != streams.end(); stream++)
+				crc = cs.CRC32((UCHAR*) &stream->second.crc, sizeof(DWORD), crc);
+		}
+		else
+		{
+			// looked up without inserting, streams that never carried data stay out of the map
+			std::map<WORD, StreamState>::iterator stream = streams.find(0);
+			if (stream != streams.end())
+				crc = stream->second.crc;
+		}
+
+		flags.FIN = 1;
+		unacked = 0;
+		SendAck(flags, header->seq, crc);
+		return;
+	}
+
+	BOOL immediate = !dack || header->flags.ACKNOW;
+	if (header->seq == expectedSeq)
+	{
+		DeliverStream(e);
+		expectedSeq++;
+		newestTime = e.time;
+		unacked++;
+
+		// a filled gap releases buffered packets, acknowledge those right away
+		std::map<DWORD, UINT64>::iterator next;
+		while ((next = outOfOrder.find(expectedSeq)) != outOfOrder.end())
+		{
+			expectedSeq++;
+			newestTime = next->second;
+			outOfOrder.erase(next);
+			immediate = TRUE;
+		}
+	}
+	else
+	{
+		// out of order or duplicate, buffer what fits and acknowledge immediately
+		if (header->seq - expectedSeq < lp.bufferSize && outOfOrder.count(header->seq) == 0)
+		{
+			DeliverStream(e);
+			outOfOrder[header->seq] = e.time;
+		}
+		immediate = TRUE;
+	}
+
+	if (immediate || unacked >= af.ackEvery)
+	{
+		SendAck(flags, expectedSeq, lp.bufferSize);
+		return;
+	}
+
+	// first packet held, arm the delayed ACK timer
+	if (unacked == 1)
+	{
+		UINT64 gen = timerGen;
+		Schedule(now + af.maxDelay, SIM_ACK_TIMER, (CHAR*) &gen, sizeof(gen));
+	}
+}
+
+INT SimBackend::Receive(CHAR* buf, INT len, LONG timeout)
+{
+	UINT64 deadline = now + max(timeout, 0);
+
+	// run the model until an ACK reaches the sender or the timeout expires
+	while (!events.empty() && events.top().time <= deadline)
+	{
+		Event e = events.top();
+		events.pop();
+		now = e.time;
+
+		if (e.type == SIM_DATA)
+			Deliver(e);
+		else if (e.type == SIM_ACK_TIMER)
+		{
+			if (*(UINT64*) e.data == timerGen && unacked > 0)
+				SendAck(Flags(), expectedSeq, lp.bufferSize);
+		}
+		else
+		{
+			INT bytes = min(len, e.size);
+			memcpy(buf, e.data, bytes);
+			return bytes;
+		}
+	}
+
+	now = deadline;
+	return 0;
+}
@@ -0,0 +1,230 @@
+// IOBackend.h
+// CSCE 463-500
+// Luke Grammer
+// 11/12/19
+
+#pragma once
+
+/* IOBackend owns the UDP socket used by TransportCore and hides how datagrams
+ * are moved in and out of the kernel. Send() returns the number of bytes queued
+ * or SOCKET_ERROR, Receive() returns the number of bytes received, 0 if the
+ * timeout (in microseconds) expired first, or SOCKET_ERROR. On failure the
+ * error code is available through WSAGetLastError(). The backends are the I/O
+ * policies of TransportCore, which holds them by value so every call resolves
+ * to the final class without a virtual dispatch. */
+class IOBackend
+{
+protected:
+	SOCKET sock = INVALID_SOCKET;
+	STRUCT sockaddr_in server;
+	LONG spinBudget = 0;
+
+public:
+	virtual ~IOBackend() {}
+
+	/* Creates and binds the socket. Returns 0 on success or SOCKET_ERROR. */
+	virtual INT Init() = 0;
+
+	/* Sets the destination for all future calls to Send(). */
+	virtual VOID SetServer(CONST STRUCT sockaddr_in& destination) { server = destination; }
+
+	/* Low-latency mode, Receive() polls without blocking for up to 'micros'
+	 * microseconds before it falls back to waiting in the kernel. */
+	VOID SetSpinBudget(LONG micros) { spinBudget = micros; }
+
+	virtual INT Send(CONST CHAR* buf, INT len) = 0;
+	virtual INT Receive(CHAR* buf, INT len, LONG timeout) = 0;
+	virtual CONST CHAR* Name() = 0;
+
+	/* Lets the backend size its buffers for a window of 'packets' outstanding
+	 * packets. On failure the current buffers stay in use. Returns 0 on success
+	 * or SOCKET_ERROR. */
+	virtual INT Resize(DWORD packets) { return STATUS_OK; }
+
+	/* Largest window the backend has buffers for, the window is clamped to it. */
+	virtual DWORD MaxWindow() { return MAXDWORD; }
+
+	/* Clock used for every RTT sample and timeout on this backend. */
+	virtual std::chrono::time_point<std::chrono::high_resolution_clock> Now() { return std::chrono::high_resolution_clock::now(); }
+
+	/* TRUE if the backend runs on a virtual clock rather than wall-clock time. */
+	virtual BOOL Simulated() { return FALSE; }
+
+};
+
+/* Classic Winsock backend, one sendto() per packet and select()/recvfrom() per ACK. */
+class SelectBackend final : public IOBackend
+{
+	/* Waits up to 'timeout' microseconds for the socket to become readable. */
+	INT Wait(LONG timeout);
+
+public:
+	~SelectBackend();
+
+	INT Init();
+	INT Send(CONST CHAR* buf, INT len);
+	INT Receive(CHAR* buf, INT len, LONG timeout);
+	CONST CHAR* Name() { return "select"; }
+};
+
+/* Registered I/O backend. Data packets are copied into a pool of send slots that
+ * is registered with the kernel, RIO_RECV_DEPTH receives are kept posted, and
+ * completions are reaped from a user-mode completion queue. Sends and receive
+ * reposts are queued with RIO_MSG_DEFER and committed in one call each when
+ * Receive() is next called, so a burst of packets or a batch of ACKs costs one
+ * kernel transition. The only other system call on the ACK path is the wait on
+ * the completion event, and only when no completion is already available. The
+ * send pool follows the window between RIO_SEND_SLOTS and RIO_MAX_SEND_SLOTS
+ * slots, the receive pool is fixed. The window never exceeds the send pool. */
+class RioBackend final : public IOBackend
+{
+	RIO_EXTENSION_FUNCTION_TABLE rio;
+	RIO_CQ completionQueue = RIO_INVALID_CQ;
+	RIO_RQ requestQueue    = RIO_INVALID_RQ;
+	HANDLE completionEvent = NULL;
+	BOOLEAN notifyArmed    = false;
+
+	// requests queued with RIO_MSG_DEFER that the kernel has not been told about yet
+	BOOLEAN sendsDeferred    = false;
+	BOOLEAN receivesDeferred = false;
+
+	// registered send memory, one MAX_PKT_SIZE slot per outstanding packet
+	CHAR* sendPool            = NULL;
+	RIO_BUFFERID sendBufferId = RIO_INVALID_BUFFERID;
+	DWORD sendSlots           = 0;
+	DWORD maxSlots            = RIO_MAX_SEND_SLOTS; // pinned to sendSlots once a resize fails
+	DWORD nextSend            = 0;
+	BOOLEAN* slotBusy         = NULL;
+
+	// registered receive memory, receive slots followed by the server address
+	CHAR* recvPool            = NULL;
+	RIO_BUFFERID recvBufferId = RIO_INVALID_BUFFERID;
+
+	// receive slots that have completed but have not been handed to the caller yet
+	DWORD ready[RIO_RECV_DEPTH]    = { 0 };
+	DWORD received[RIO_RECV_DEPTH] = { 0 };
+	DWORD readyHead  = 0;
+	DWORD readyCount = 0;
+
+	ULONG RecvOffset(DWORD slot) { return slot * MAX_PKT_SIZE; }
+	ULONG AddrOffset() { return RIO_RECV_DEPTH * MAX_PKT_SIZE; }
+
+	/* Allocates and registers 'slots' send slots, then releases the old pool. Must
+	 * only be called with no sends outstanding. Returns FALSE on failure, leaving
+	 * the old pool in place. */
+	BOOL AllocSendPool(DWORD slots);
+	VOID FreeSendPool();
+
+	/* Queues receive slot 'slot' on the request queue, committed by CommitReceives(). */
+	BOOL PostReceive(DWORD slot);
+
+	/* Hands every deferred send or receive to the kernel in a single call. Returns FALSE
+	 * on failure. */
+	BOOL CommitSends();
+	BOOL CommitReceives();
+
+	/* Drains the completion queue without blocking. Every completion dequeued is
+	 * processed, failed receives are posted again. Returns the number of completions
+	 * processed or SOCKET_ERROR if any of them failed. */
+	INT Poll();
+
+public:
+	RioBackend(DWORD slots = RIO_SEND_SLOTS) : sendSlots(slots) {}
+	~RioBackend();
+
+	INT Init();
+	VOID SetServer(CONST STRUCT sockaddr_in& destination);
+	INT Send(CONST CHAR* buf, INT len);
+	INT Receive(CHAR* buf, INT len, LONG timeout);
+	INT Resize(DWORD packets);
+	DWORD MaxWindow() { return maxSlots; }
+	CONST CHAR* Name() { return "rio"; }
+};
+
+/* Deterministic discrete-event simulation backend. Nothing touches the network:
+ * packets pass through an in-process model of the emulated path (seeded loss in
+ * each direction, a tail-drop bottleneck queue at the link speed and RTT / 2 of
+ * propagation delay each way) to a model receiver that ACKs like the real server,
+ * including out-of-order buffering, negotiated ACK coalescing and independent
+ * delivery of multiplexed streams. The path is
+ * configured from the LinkProperties in the SYN. Time only advances when Receive()
+ * processes the next event or runs out its timeout, so a transfer finishes as fast
+ * as the CPU allows and is reproducible for a given seed. */
+class SimBackend final : public IOBackend
+{
+	enum EventType { SIM_DATA, SIM_ACK, SIM_ACK_TIMER };
+
+	struct Event
+	{
+		UINT64 time;    // virtual microseconds
+		UINT64 order;   // tie breaker, keeps equal-time events in FIFO order
+		EventType type; // data reaching the receiver, ACK reaching the sender or delayed ACK timer
+		INT size;
+		CHAR data[MAX_PKT_SIZE];
+
+		BOOL operator>(CONST Event& e) CONST { return (time != e.time) ? time > e.time : order > e.order; }
+	};
+
+	std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+	std::deque<UINT64> bottleneck; // departure times of packets queued at the router
+	std::mt19937 rng;
+	UINT64 now        = 0;
+	UINT64 nextOrder  = 0;
+	UINT64 linkFree   = 0;
+
+	// emulated path, taken from the SYN
+	LinkProperties lp;
+
+	// delivery state of one stream at the model receiver
+	struct StreamState
+	{
+		DWORD expectedSeq = 0;
+		DWORD crc         = 0;
+		std::map<DWORD, std::vector<CHAR>> pending; // payloads waiting on an earlier stream sequence
+	};
+
+	// model receiver
+	DWORD expectedSeq    = 0;
+	BOOLEAN multiplexed  = false;
+	Checksum cs;
+	std::map<DWORD, UINT64> outOfOrder; // arrival times of packets received ahead of expectedSeq
+	std::map<WORD, StreamState> streams;
+	WORD lastStream      = 0; // stream of the newest data packet, its window goes in the next ACK
+
+	// model receiver ACK coalescing
+	BOOLEAN dack      = false;
+	AckFrequency af;
+	DWORD unacked     = 0; // in-order packets not acknowledged yet
+	UINT64 newestTime = 0; // arrival of the newest in-order packet
+	UINT64 timerGen   = 0; // invalidates delayed ACK timers that are no longer needed
+
+	/* Returns TRUE with probability 'p'. */
+	BOOL Lose(FLOAT p) { return rng() < p * 4294967296.0; }
+
+	VOID Schedule(UINT64 time, EventType type, CONST CHAR* buf, INT len);
+
+	/* Runs the model receiver on a packet that made it across the forward path. */
+	VOID Deliver(CONST Event& e);
+
+	/* Hands a new data packet to its stream, which delivers it once every earlier packet
+	 * of that stream has arrived, regardless of gaps in other streams. */
+	VOID DeliverStream(CONST Event& e);
+
+	/* Sends a cumulative ACK from the model receiver. Data ACKs on a multiplexed connection
+	 * carry the window of 'lastStream', the router buffer less what that stream holds back. */
+	VOID SendAck(Flags flags, DWORD ackSeq, DWORD recvWnd);
+
+public:
+	SimBackend(DWORD seed = 0) : rng(seed) {}
+
+	/* Reseeds the loss model, must be called before the first Send(). */
+	VOID Seed(DWORD seed) { rng.seed(seed); }
+
+	INT Init() { return STATUS_OK; }
+	INT Send(CONST CHAR* buf, INT len);
+	INT Receive(CHAR* buf, INT len, LONG timeout);
+	CONST CHAR* Name() { return "sim"; }
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> Now();
+	BOOL Simulated() { return TRUE; }
+};
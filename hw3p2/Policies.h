@@ -0,0 +1,223 @@
+// Policies.h
+// CSCE 463-500
+// Luke Grammer
+// 11/12/19
+
+#pragma once
+
+/* Policies plugged into TransportCore at compile time. TransportCore only ever
+ * calls them on their concrete type, so every call below can be inlined into
+ * the send and ACK paths. WindowTuner (WindowTuner.h) is the adaptive congestion
+ * control policy and the IOBackend subclasses are the I/O policies. */
+
+// ************** CONGESTION CONTROL ************** //
+
+/* Keeps the window requested in Open() for the life of the connection. */
+class FixedWindow
+{
+	DWORD window = 1;
+
+public:
+	// duplicate ACKs that trigger a fast retransmit
+	static CONST DWORD FastRetxThreshold = FAST_RTX_NUM;
+
+	/* Returns 'senderWindow', or the BDP of the configured link for AUTO_WINDOW. */
+	DWORD Start(DWORD senderWindow, FLOAT speed, FLOAT rtt)
+	{
+		window = (senderWindow == AUTO_WINDOW) ? WindowTuner::LinkWindow(speed, rtt) : senderWindow;
+		return window;
+	}
+
+	DWORD Init(DWORD rtt, DWORD receiverWindow, std::chrono::time_point<std::chrono::high_resolution_clock> now) { return window; }
+	DWORD OnAck(DWORD bytes, DWORD rtt, DWORD inFlight, std::chrono::time_point<std::chrono::high_resolution_clock> now) { return window; }
+
+	/* Caps the window at the 'packets' the I/O backend can keep in flight. */
+	DWORD Limit(DWORD packets)
+	{
+		window = min(window, packets);
+		return window;
+	}
+};
+
+// **************** RTO ESTIMATORS **************** //
+
+/* Jacobson/Karels on millisecond samples with at least 4 * 10 ms of deviation
+ * allowance, the estimator the transport has always used. */
+class JacobsonRto
+{
+	INT estRTT = 0; // ms
+	INT devRTT = 0; // ms
+	DWORD RTO  = 0; // ms
+
+public:
+	// transmissions of a data or FIN packet before giving up
+	static CONST USHORT MaxAttempts = MAX_DATA_ATTEMPTS;
+
+	/* Timeout for the handshake from the configured 'rtt' (seconds). */
+	VOID Start(FLOAT rtt) { RTO = max(1000, 2 * (rtt * 1000)); }
+
+	/* Seeds the estimate with the handshake RTT (microseconds). */
+	VOID Init(DWORD rtt)
+	{
+		estRTT = (INT) (rtt / 1000);
+		devRTT = 0;
+		RTO = estRTT + 4 * max(devRTT, 10);
+	}
+
+	/* Folds in an RTT sample (microseconds). */
+	VOID OnSample(DWORD rtt)
+	{
+		estRTT = .875 * estRTT + .125 * (INT) (rtt / 1000);
+		devRTT = .75 * devRTT + .25 * abs((INT) (rtt / 1000) - estRTT);
+		RTO = estRTT + 4 * max(devRTT, 10);
+	}
+
+	DWORD Timeout() { return RTO * 1000; } // microseconds
+	INT EstRTT() { return estRTT; }        // ms
+	INT DevRTT() { return devRTT; }        // ms
+};
+
+/* RFC 6298 on microsecond samples. Keeps sub-millisecond paths from being rounded
+ * down to nothing and only pads the timeout by RTO_GRANULARITY of clock error. */
+class MicrosecondRto
+{
+	DOUBLE srtt   = 0; // microseconds
+	DOUBLE rttvar = 0; // microseconds
+	DWORD RTO     = 0; // microseconds
+
+public:
+	static CONST USHORT MaxAttempts = MAX_DATA_ATTEMPTS;
+
+	VOID Start(FLOAT rtt) { RTO = (DWORD) max(1000000, 2 * (rtt * 1000000)); }
+
+	VOID Init(DWORD rtt)
+	{
+		srtt = rtt;
+		rttvar = rtt / 2.0;
+		RTO = (DWORD) (srtt + max(4 * rttvar, RTO_GRANULARITY));
+	}
+
+	VOID OnSample(DWORD rtt)
+	{
+		rttvar = .75 * rttvar + .25 * abs(srtt - rtt);
+		srtt = .875 * srtt + .125 * rtt;
+		RTO = (DWORD) (srtt + max(4 * rttvar, RTO_GRANULARITY));
+	}
+
+	DWORD Timeout() { return RTO; }
+	INT EstRTT() { return (INT) (srtt / 1000); }
+	INT DevRTT() { return (INT) (rttvar / 1000); }
+};
+
+// *************** CHECKSUM KERNELS *************** //
+
+/* CRC-32 of the data as sent, checked against the checksum the receiver returns in
+ * the FIN-ACK. */
+class Crc32Kernel
+{
+	Checksum cs;
+
+public:
+	static CONST BOOL Enabled = TRUE;
+
+	/* Continues checksum 'crc' over 'len' bytes of 'buf'. */
+	DWORD Update(CONST CHAR* buf, size_t len, DWORD crc) { return cs.CRC32((UCHAR*) buf, len, crc); }
+};
+
+/* Skips checksumming entirely, Close() does not verify the FIN-ACK. The default, the
+ * caller can still compare the checksum in the FIN-ACK with its own data. */
+class NullChecksum
+{
+public:
+	static CONST BOOL Enabled = FALSE;
+
+	DWORD Update(CONST CHAR* buf, size_t len, DWORD crc) { return 0; }
+};
+
+// ****************** STATS SINKS ***************** //
+
+/* Publishes transport state to a Properties structure and runs the StatsManager
+ * thread that prints it every STATS_INTERVAL seconds. */
+class PropertiesStats
+{
+	Properties* properties;
+	HANDLE statsHandle = NULL;
+
+public:
+	PropertiesStats(Properties* p) : properties(p) {}
+
+	/* Signals the stats thread to quit and waits for it. A transport that never started
+	 * the thread leaves the event alone, another transport may share the Properties. */
+	~PropertiesStats()
+	{
+		if (statsHandle != NULL)
+		{
+			SetEvent(properties->eventQuit);
+			WaitForSingleObject(statsHandle, INFINITE);
+			CloseHandle(statsHandle);
+		}
+	}
+
+	/* Starts the stats thread. Returns FALSE if it could not be created. */
+	BOOL Start()
+	{
+		// the quit event is manual-reset, clear anything left by an earlier transport
+		ResetEvent(properties->eventQuit);
+		statsHandle = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)StatsManager::PrintStats, properties, 0, NULL);
+		return statsHandle != NULL;
+	}
+
+	/* Stats thread, NULL if it is not running. */
+	HANDLE Thread() { return statsHandle; }
+
+	VOID OnOpen(std::chrono::time_point<std::chrono::high_resolution_clock> now) { properties->totalTime = now; }
+
+	VOID OnWindow(UINT64 senderBase, UINT64 sequenceNum, DWORD windowSize)
+	{
+		InterlockedExchange64((volatile LONG64*)&properties->senderBase, senderBase);
+		InterlockedExchange64((volatile LONG64*)&properties->sequenceNum, sequenceNum);
+		InterlockedExchange((volatile LONG*)&properties->windowSize, windowSize);
+	}
+
+	VOID OnAck(DWORD bytes)
+	{
+		InterlockedAdd64((volatile LONG64*)&properties->bytesAcked, bytes);
+		InterlockedAdd64((volatile LONG64*)&properties->goodput, bytes);
+	}
+
+	/* Records RTT 'sample' (microseconds) and the estimator state (ms). A 'sample'
+	 * of 0 only updates the estimate. */
+	VOID OnRtt(DWORD sample, INT estRTT, INT devRTT)
+	{
+		EnterCriticalSection(&properties->criticalSection);
+		if (sample > 0)
+		{
+			properties->rttSamples++;
+			properties->rttSumMicros += sample;
+			properties->minRTTMicros = min(properties->minRTTMicros, sample);
+		}
+		properties->estRTT = estRTT;
+		properties->devRTT = devRTT;
+		LeaveCriticalSection(&properties->criticalSection);
+	}
+
+	VOID OnTimeout() { InterlockedIncrement64((volatile LONG64*)&properties->timeoutPackets); }
+	VOID OnFastRetx() { InterlockedIncrement64((volatile LONG64*)&properties->fastRetxPackets); }
+};
+
+/* Discards all statistics, for benchmarks that only time the transfer. */
+class NullStats
+{
+public:
+	NullStats(Properties* p) {}
+
+	BOOL Start() { return TRUE; }
+	HANDLE Thread() { return NULL; }
+
+	VOID OnOpen(std::chrono::time_point<std::chrono::high_resolution_clock> now) {}
+	VOID OnWindow(UINT64 senderBase, UINT64 sequenceNum, DWORD windowSize) {}
+	VOID OnAck(DWORD bytes) {}
+	VOID OnRtt(DWORD sample, INT estRTT, INT devRTT) {}
+	VOID OnTimeout() {}
+	VOID OnFastRetx() {}
+};
@@ -26,18 +26,16 @@ void StatsManager::PrintStats(LPVOID properties)
 		// time since last print
 		size_t segmentTime = std::chrono::duration_cast<std::chrono::milliseconds>(stopTime - segmentStartTime).count();
 
+		// take and reset goodput in one step so bytes acked in between are not lost
+		UINT64 goodput = InterlockedExchange64((volatile LONG64*)&p->goodput, 0);
+
 		// print statistics
-		std::printf("[%2d] B %6d (%5.1f MB) N %6d T %d F %d W %d S %0.3f Mbps RTT %5.3f\n",
+		std::printf("[%2d] B %6llu (%5.1f MB) N %6llu T %llu F %llu W %d S %0.3f Mbps RTT %5.3f\n",
 			(int) std::chrono::duration_cast<std::chrono::seconds>(stopTime - p->totalTime).count(), 
-			p->senderBase, p->bytesAcked / 1000000.0, (DWORD) (p->senderBase + 1), p->timeoutPackets, 
-			p->fastRetxPackets, p->windowSize, ((UINT64) p->goodput * 8) / (1000.0 * segmentTime), 
+			p->senderBase, p->bytesAcked / 1000000.0, p->sequenceNum, p->timeoutPackets, 
+			p->fastRetxPackets, p->windowSize, (goodput * 8) / (1000.0 * segmentTime), 
 			p->estRTT / 1000.0);
 
-		// reset goodput
-		EnterCriticalSection(&p->criticalSection);
-		p->goodput = 0;
-		LeaveCriticalSection(&p->criticalSection);
-
 		segmentStartTime = std::chrono::high_resolution_clock::now();
 	}
 
@@ -0,0 +1,892 @@
+// TransportCore.cpp
+// CSCE 463-500
+// Luke Grammer
+// 11/12/19
+
+#include "pch.h"
+
+using namespace std;
+
+/* Constructor initializes WinSock, which the transport owns so that it outlives the
+ * I/O backend. calls exit() if WinSock cannot be initialized. */
+Transport::Transport()
+{
+	STRUCT WSAData wsaData;
+	WORD wVerRequested;
+
+	//initialize WinSock
+	wVerRequested = MAKEWORD(2, 2);
+	if (WSAStartup(wVerRequested, &wsaData) != 0) {
+		printf("\tWSAStartup error %d\n", WSAGetLastError());
+		WSACleanup();
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* Basic destructor cleans up WinSock. */
+Transport::~Transport()
+{
+	WSACleanup();
+}
+
+/* Affinity mask of logical processor 'core', or 0 if 'core' is negative, does not
+ * fit in a DWORD_PTR or is not in the process affinity mask. */
+DWORD_PTR Transport::CoreMask(INT core)
+{
+	if (core < 0 || core >= (INT) (sizeof(DWORD_PTR) * 8))
+		return 0;
+
+	DWORD_PTR processMask, systemMask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+		return 0;
+
+	return processMask & ((DWORD_PTR) 1 << core);
+}
+
+/* Constructor sets up the server address, the I/O backend is not touched until Init().
+ * The stats sink publishes to 'p'. */
+TRANSPORT_TEMPLATE
+TRANSPORT_CORE::TransportCore(Properties* p) : stats(p)
+{
+	// Set up address for local DNS server
+	memset(&server, 0, sizeof(server));
+	server.sin_family = AF_INET;
+}
+
+/* Basic destructor cleans up the packet slots, the policies clean up after themselves. */
+TRANSPORT_TEMPLATE
+TRANSPORT_CORE::~TransportCore()
+{
+	//cout << "DEBUG: Calling TransportCore destructor\n";
+	delete[] slots;
+}
+
+/* Opens and binds the UDP socket through the I/O backend, then starts the stats thread
+ * for the life of the transport. The stats thread is not started for simulated transfers.
+ * Returns 0 to indicate success or SOCKET_ERROR. calls exit() if the stats thread cannot
+ * be created. */
+TRANSPORT_TEMPLATE
+INT TRANSPORT_CORE::Init()
+{
+	if (io.Init() != STATUS_OK)
+		return SOCKET_ERROR;
+
+	totalTime = io.Now();
+	stats.OnOpen(totalTime);
+
+	// wall-clock statistics mean nothing on a virtual clock
+	if (io.Simulated())
+		return STATUS_OK;
+
+	// Create Stats thread
+	//cout << "DEBUG: About to create stats thread\n";
+	if (!stats.Start())
+	{
+		printf("Could not create stats thread! exiting...\n");
+		exit(EXIT_FAILURE);
+	}
+	//cout << "DEBUG: Created stats thread\n";
+
+	return STATUS_OK;
+}
+
+/* GetServerInfo does a forward lookup on the destination host string if necessary
+ * and populates it's internal server information with the result. Called in Open().
+ * Simulated transfers accept any host without a lookup. Returns code 0 to indicate
+ * success or 3 if the target hostname does not have an entry in DNS. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::GetServerInfo(CONST CHAR* destination, WORD port)
+{
+	STRUCT hostent* remote;
+	DWORD destinationIP = inet_addr(destination);
+
+	// host is a valid IP, do not do a DNS lookup
+	if (destinationIP != INADDR_NONE)
+		server.sin_addr.S_un.S_addr = destinationIP;
+	// a simulated path never leaves the process, so a simulated run needs no DNS either
+	else if (io.Simulated())
+	{
+		destinationIP = htonl(INADDR_LOOPBACK);
+		server.sin_addr.S_un.S_addr = destinationIP;
+	}
+	else
+	{
+		if ((remote = gethostbyname(destination)) == NULL)
+		{
+			// failure in gethostbyname
+			chrono::time_point<chrono::high_resolution_clock> stopTime = io.Now();
+			printf("[%2.3f] --> ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+			printf("target %s is invalid\n", destination);
+			return INVALID_NAME;
+		}
+		// take the first IP address and copy into sin_addr
+		else
+		{
+			destinationIP = *(u_long*)remote->h_addr;
+			memcpy((char*) & (server.sin_addr), remote->h_addr, remote->h_length);
+		}
+	}
+	server.sin_port = htons(port);
+	serverAddr.s_addr = destinationIP;
+	io.SetServer(server);
+
+	return STATUS_OK;
+}
+
+/* Open() calls GetServerInfo() to populate internal server information and then creates a handshake
+ * packet and attempts to send it to the corresponding server. If un-acknowledged, it will retransmit
+ * this packet up to MAX_SYN_ATTEMPS times (by default 3). Open() will set the retransmission
+ * timeout for future communication with the server to a constant scale of the handshake RTT.
+ * Passing AUTO_WINDOW as 'senderWindow' sizes the window from the link speed and the handshake
+ * RTT and keeps tuning it for the life of the connection.
+ * Returns 0 to indicate success or a positive number to indicate failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::Open(CONST CHAR* destination, WORD port, DWORD senderWindow, STRUCT LinkProperties* lp)
+{
+	INT result = -1;
+	// an open connection keeps its estimator and window
+	if (connected)
+		return ALREADY_CONNECTED;
+
+	rto.Start(lp->RTT);
+
+	// until the handshake RTT is known, size the router buffer for the configured link
+	windowSize = congestion.Start(senderWindow, lp->speed, lp->RTT);
+	Publish();
+
+	if ((result = GetServerInfo(destination, port)) != STATUS_OK)
+		return result;
+
+	// create handshake packet, the ACK frequency is only sent if coalescing was requested
+	SenderDackSynHeader handshake;
+	handshake.ssh.sdh.flags.SYN = 1;
+	handshake.ssh.sdh.flags.DACK = (ackFrequency.ackEvery > 1);
+	handshake.ssh.sdh.flags.STRM = (streams.size() > 1);
+	handshake.ssh.sdh.seq = (DWORD) senderBase;
+	handshake.ssh.lp = *lp;
+	handshake.ssh.lp.bufferSize = windowSize + Estimator::MaxAttempts;
+	handshake.af = ackFrequency;
+	INT handshakeSize = handshake.ssh.sdh.flags.DACK ? sizeof(SenderDackSynHeader) : sizeof(SenderSynHeader);
+
+	// attempt to send SYN and receive ACK MAX_SYN_ATTEMPTS times
+	CHAR* buf = new CHAR[MAX_PKT_SIZE];
+
+	chrono::time_point<chrono::high_resolution_clock> startTime, stopTime;
+
+	for (USHORT i = 1; i <= MAX_SYN_ATTEMPTS; i++)
+	{
+		// ************ SEND MESSAGE ************ //
+		stopTime = io.Now();
+		//printf("[%2.3f] --> ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+		//printf("DEBUG-SYN: Seq. %d (attempt %d of %d, RTO % .3f) to %s\n", handshake.ssh.sdh.seq, i, MAX_SYN_ATTEMPTS, (rto.Timeout() / 1000000.0), inet_ntoa(serverAddr));
+		
+		// attempt to send the SYN packet to server
+		result = io.Send((CHAR*)&handshake, handshakeSize);
+		if (result == SOCKET_ERROR)
+		{
+			stopTime = io.Now();
+			printf("[%2.3f] --> ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+			printf("failed sendto with %d\n", WSAGetLastError());
+			delete[] buf;
+			return FAILED_SEND;
+		}
+
+		startTime = io.Now();
+
+		// ********** RECEIVE RESPONSE ********** //
+		if ((result = ReceiveACK(buf, (DWORD) senderBase)) != TIMEOUT)
+		{
+			stopTime = io.Now();
+			if (result == STATUS_OK)
+			{
+				ReceiverHeader responseHeader = *(ReceiverHeader*)buf;
+				//printf("[%2.3f] <-- ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+				
+				DWORD rtt = (DWORD) chrono::duration_cast<chrono::microseconds>(stopTime - startTime).count();
+				rto.Init(rtt);
+				//printf("DEBUG-SYN: Got packet, estimated RTT %d\n", rto.EstRTT());
+				stats.OnRtt(0, rto.EstRTT(), rto.DevRTT());
+				//printf("DEBUG-SYN: Setting RTO to %d us\n", rto.Timeout());
+
+				// receivers that do not support coalescing ignore the request
+				delayedACKs = handshake.ssh.sdh.flags.DACK && responseHeader.flags.DACK;
+				multiplexed = handshake.ssh.sdh.flags.STRM && responseHeader.flags.STRM;
+				receiverWindow = max(responseHeader.recvWnd, 1);
+
+				windowSize = congestion.Init(rtt, receiverWindow, stopTime);
+
+				// the window cannot outgrow the buffers the backend actually has, and the
+				// congestion policy has to know so it does not keep growing past them
+				if (io.Resize(windowSize) != STATUS_OK)
+					printf("Main:   could not resize I/O buffers for window %d (error %d), window limited to %d\n",
+						windowSize, WSAGetLastError(), io.MaxWindow());
+				windowSize = congestion.Limit(io.MaxWindow());
+				Reserve(windowSize);
+
+				sequenceNum = senderBase;
+				Publish();
+				connected = true;
+				delete[] buf;
+				return STATUS_OK;
+			}
+			else
+			{
+				delete[] buf;
+				return result;
+			}
+		}
+	}
+
+	// all attempts timed out, return
+	delete[] buf;
+	return TIMEOUT;
+}
+
+/* Attempts to send a single packet to the connected server. This is the externally facing 
+ * Send() function and therefore requires a previously successful call to Open(). Up to a
+ * window of packets are kept in flight, Send() only blocks while the window is full.
+ * The packet goes out on stream 0 right away, ahead of anything queued by Write().
+ * Returns INVALID_ARGUMENTS if 'messageSize' is negative or exceeds MaxPayload(),
+ * otherwise 0 to indicate success or a positive number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::Send(CONST CHAR* message, INT messageSize)
+{
+	WORD result = STATUS_OK;
+	// send single packet to server with connectivity check
+	if (!connected)
+		return NOT_CONNECTED;
+
+	// the packet buffer holds one MAX_PKT_SIZE datagram
+	if (messageSize < 0 || messageSize > MaxPayload())
+		return INVALID_ARGUMENTS;
+
+	// wait for the window to open up
+	while (sequenceNum - senderBase >= Window() || streams[0].inFlight >= StreamWindow(streams[0]))
+	{
+		if ((result = ReceiveACKs(TRUE)) != STATUS_OK)
+			return result;
+	}
+
+	// Find next available sequence number
+	UINT64 seq = sequenceNum;
+	Frame(seq, 0, message, messageSize);
+
+	if ((result = Transmit(seq)) != STATUS_OK)
+		return result;
+	sequenceNum++;
+	Publish();
+
+	// pick up ACKs that have already arrived so they do not sit in the socket inflating RTT samples
+	return ReceiveACKs(FALSE);
+}
+
+/* Opens another stream with the given 'urgency' (0 to STREAM_MAX_URGENCY, lower is sent
+ * first) and per-stream 'window' in packets (0 for the connection window), returning its ID
+ * in 'streamId'. On top of it, a multiplexing receiver advertises a window per stream in its
+ * ACKs, and the stream never has more in flight than either allows. Must be called before
+ * Open(), which asks the receiver to deliver each stream
+ * independently. Returns 0 to indicate success or a positive number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::OpenStream(DWORD& streamId, DWORD urgency, DWORD window)
+{
+	if (connected)
+		return ALREADY_CONNECTED;
+
+	// stream IDs are a WORD on the wire
+	if (streams.size() > MAXWORD)
+		return INVALID_STREAM;
+
+	Stream stream;
+	stream.urgency = min(urgency, STREAM_MAX_URGENCY);
+	stream.window = window;
+
+	streamId = (DWORD) streams.size();
+	streams.push_back(stream);
+	return STATUS_OK;
+}
+
+/* Queues a message of any length on stream 'streamId' and sends as much as the window
+ * allows without blocking. The message is sent straight from 'message', which must stay
+ * valid until Flush() or Close() returns. Streams other than 0 fail with INVALID_STREAM
+ * unless the receiver accepted multiplexing. Returns 0 to indicate success or a positive
+ * number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::Write(DWORD streamId, CONST CHAR* message, UINT64 messageSize)
+{
+	WORD result = STATUS_OK;
+
+	if (!connected)
+		return NOT_CONNECTED;
+
+	// without multiplexing the receiver only sees one sequence-ordered stream
+	if (streamId >= streams.size() || (streamId > 0 && !multiplexed))
+		return INVALID_STREAM;
+
+	if (messageSize == 0)
+		return STATUS_OK;
+
+	Message queued = { message, messageSize };
+	streams[streamId].queue.push_back(queued);
+
+	if ((result = Pump()) != STATUS_OK)
+		return result;
+
+	return ReceiveACKs(FALSE);
+}
+
+/* Fills in the slot for sequence number 'seq' with the next packet of stream 'streamId'. */
+TRANSPORT_TEMPLATE
+VOID TRANSPORT_CORE::Frame(UINT64 seq, WORD streamId, CONST CHAR* message, INT messageSize)
+{
+	Packet& packet = slots[seq % capacity];
+	Stream& stream = streams[streamId];
+
+	// without multiplexing only the leading SenderDataHeader goes on the wire
+	SenderStreamHeader header;
+	header.sdh.seq = (DWORD) seq;
+	header.stream = streamId;
+	header.streamSeq = (DWORD) stream.nextSeq++;
+
+	memcpy(packet.data, &header, HeaderSize());
+	memcpy(packet.data + HeaderSize(), message, messageSize);
+	packet.size = HeaderSize() + messageSize;
+	packet.attempts = 0;
+	packet.stream = streamId;
+
+	stream.inFlight++;
+
+	// the receiver checks multiplexed streams one by one, a single stream in sequence order
+	if (Kernel::Enabled)
+	{
+		if (multiplexed)
+			stream.crc = kernel.Update(message, messageSize, stream.crc);
+		else
+			crc = kernel.Update(message, messageSize, crc);
+	}
+}
+
+/* Picks the stream to send from next: the lowest urgency with data queued and room in its
+ * window, round robin between streams of the same urgency. Returns -1 if there is none. */
+TRANSPORT_TEMPLATE
+INT TRANSPORT_CORE::NextStream()
+{
+	INT next = -1;
+	DWORD count = (DWORD) streams.size();
+
+	for (DWORD i = 0; i < count; i++)
+	{
+		DWORD id = (nextStream + i) % count;
+		Stream& stream = streams[id];
+		if (stream.queue.empty() || stream.inFlight >= StreamWindow(stream))
+			continue;
+
+		// the first stream after the last one served wins a tie
+		if (next < 0 || stream.urgency < streams[next].urgency)
+			next = id;
+	}
+
+	if (next >= 0)
+		nextStream = (next + 1) % count;
+
+	return next;
+}
+
+/* Transmits queued stream data until the window is full or nothing is left to send.
+ * Returns 0 to indicate success or a positive number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::Pump()
+{
+	WORD result = STATUS_OK;
+	INT id = -1;
+
+	while (sequenceNum - senderBase < Window() && (id = NextStream()) >= 0)
+	{
+		Stream& stream = streams[id];
+		Message& message = stream.queue.front();
+		DWORD bytes = (DWORD) min(message.size - stream.offset, (UINT64) MaxPayload());
+
+		UINT64 seq = sequenceNum;
+		Frame(seq, id, message.data + stream.offset, bytes);
+
+		stream.offset += bytes;
+		if (stream.offset == message.size)
+		{
+			stream.queue.pop_front();
+			stream.offset = 0;
+		}
+
+		if ((result = Transmit(seq)) != STATUS_OK)
+			return result;
+		sequenceNum++;
+		Publish();
+	}
+
+	return STATUS_OK;
+}
+
+/* (Re)transmits the packet with sequence number 'seq'. Returns 0 to indicate
+ * success or a positive number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::Transmit(UINT64 seq)
+{
+	Packet& packet = slots[seq % capacity];
+	SenderDataHeader* header = (SenderDataHeader*)packet.data;
+
+	// with coalescing, ask for an immediate ACK whenever the sender is about to stall on it
+	header->flags.ACKNOW = delayedACKs && (packet.attempts > 0 || seq + 1 - senderBase >= Window() ||
+		streams[packet.stream].inFlight >= StreamWindow(streams[packet.stream]));
+
+	packet.attempts++;
+	packet.txTime = io.Now();
+	if (seq == senderBase)
+		timerStart = packet.txTime;
+
+	//printf("DEBUG-SEND: SN %llu (attempt %d of %d, RTO % .3f)\n", seq, packet.attempts, Estimator::MaxAttempts, (rto.Timeout() / 1000000.0));
+	if (io.Send(packet.data, packet.size) == SOCKET_ERROR)
+	{
+		chrono::time_point<chrono::high_resolution_clock> stopTime = io.Now();
+		printf("[%2.3f] --> ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+		printf("failed sendto with %d\n", WSAGetLastError());
+		return FAILED_SEND;
+	}
+
+	return STATUS_OK;
+}
+
+/* Handles acknowledgements for data packets in flight, retransmitting senderBase on
+ * timeout or after Congestion::FastRetxThreshold duplicate ACKs. If 'block' is TRUE, waits until
+ * senderBase advances, otherwise only consumes ACKs that have already arrived.
+ * Returns 0 to indicate success or a positive number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::ReceiveACKs(BOOL block)
+{
+	INT result = -1;
+	chrono::time_point<chrono::high_resolution_clock> stopTime;
+
+	while (senderBase != sequenceNum)
+	{
+		// the receiver may legitimately hold an ACK for up to maxDelay
+		stopTime = io.Now();
+		LONG timeLeft = rto.Timeout() + (delayedACKs ? ackFrequency.maxDelay : 0) - chrono::duration_cast<chrono::microseconds>(stopTime - timerStart).count();
+
+		// add margin of error because select operates +- 1 ms from the actual timeout value 
+		if (timeLeft < 1000)
+		{
+			//cout << "RCV-DEBUG: Timeout\n";
+			stats.OnTimeout();
+			if (slots[senderBase % capacity].attempts >= Estimator::MaxAttempts)
+				return TIMEOUT;
+
+			numDuplicateACKS = 0;
+			if ((result = Transmit(senderBase)) != STATUS_OK)
+				return result;
+			continue;
+		}
+
+		// attempt to get response from server within the time left
+		result = io.Receive(response, MAX_PKT_SIZE, block ? timeLeft : 0);
+		if (result == 0 && !block)
+			return STATUS_OK;
+		if (result == SOCKET_ERROR)
+		{
+			stopTime = io.Now();
+			printf("[%2.3f] <-- ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+			printf("failed recvfrom with %d\n", WSAGetLastError());
+			return FAILED_RECV;
+		}
+
+		// runts are not ACKs
+		if (result < (INT) sizeof(ReceiverHeader))
+			continue;
+
+		stopTime = io.Now();
+		ReceiverHeader responseHeader = *(ReceiverHeader*)response;
+
+		// the delay is only there if the datagram is long enough to carry it, a short one is a plain ACK
+		BOOL carriesDelay = delayedACKs && responseHeader.flags.DACK && result >= (INT) sizeof(ReceiverDackHeader);
+		DWORD ackDelay = carriesDelay ? ((ReceiverDackHeader*)response)->ackDelay : 0;
+		receiverWindow = max(responseHeader.recvWnd, 1);
+
+		// a multiplexing receiver also advertises the window of the stream that triggered the ACK
+		if (multiplexed && responseHeader.flags.STRM && result >= (INT) sizeof(ReceiverStreamHeader))
+		{
+			ReceiverStreamHeader* streamHeader = (ReceiverStreamHeader*)response;
+			if (streamHeader->stream < streams.size())
+				streams[streamHeader->stream].receiverWindow = max(streamHeader->streamWnd, 1);
+		}
+
+		UINT64 ackSeq = Unwrap(responseHeader.ackSeq);
+		if (ackSeq > senderBase && ackSeq <= sequenceNum)
+		{
+			//printf("RCV-DEBUG: Received ACK %llu, moving window\n", ackSeq);
+			AdvanceWindow(ackSeq, ackDelay, stopTime);
+			if (block)
+				return STATUS_OK;
+		}
+		else if (ackSeq == senderBase && ackDelay == 0)
+		{
+			// only immediate ACKs are duplicates, a held ACK that repeats senderBase is just stale
+			//printf("RCV-DEBUG: Received duplicate ACK %d\n", responseHeader.ackSeq);
+			numDuplicateACKS++;
+			if (numDuplicateACKS == Congestion::FastRetxThreshold)
+			{
+				//printf("RCV-DEBUG: Fast retransmit signalled\n");
+				stats.OnFastRetx();
+				if (slots[senderBase % capacity].attempts >= Estimator::MaxAttempts)
+					return TIMEOUT;
+				if ((result = Transmit(senderBase)) != STATUS_OK)
+					return result;
+			}
+		}
+	}
+
+	return STATUS_OK;
+}
+
+/* Slides the window up to 'ackSeq', taking an RTT sample from the newest packet
+ * it acknowledges with the receiver's 'ackDelay' (in microseconds) removed, unless
+ * the ACK covers a retransmitted packet. */
+TRANSPORT_TEMPLATE
+VOID TRANSPORT_CORE::AdvanceWindow(UINT64 ackSeq, DWORD ackDelay, chrono::time_point<chrono::high_resolution_clock> now)
+{
+	DWORD inFlight = (DWORD) (sequenceNum - senderBase);
+	DWORD bytes = 0;
+	BOOL retransmitted = false;
+	for (UINT64 seq = senderBase; seq != ackSeq; seq++)
+	{
+		Packet& packet = slots[seq % capacity];
+		bytes += packet.size - HeaderSize();
+		retransmitted |= (packet.attempts > 1);
+
+		Stream& stream = streams[packet.stream];
+		stream.inFlight--;
+		if (stream.inFlight == 0 && stream.queue.empty())
+			stream.finished = now;
+	}
+
+	stats.OnAck(bytes);
+
+	// Karn's algorithm, a cumulative ACK that covers a retransmission may have been sent when
+	// it filled a gap, so the newest packet's send time says nothing about this round trip
+	Packet& newest = slots[(ackSeq - 1) % capacity];
+	DWORD sample = 0;
+	if (!retransmitted)
+	{
+		LONG64 rtt = chrono::duration_cast<chrono::microseconds>(now - newest.txTime).count() - ackDelay;
+		sample = (DWORD) max(rtt, 1);
+
+		rto.OnSample(sample);
+		stats.OnRtt(sample, rto.EstRTT(), rto.DevRTT());
+		//printf("DEBUG-SEND: Setting RTO to %d us (est. RTT %.3fs est. DEV %.3fs)\n", rto.Timeout(), rto.EstRTT() / 1000.0, rto.DevRTT() / 1000.0);
+	}
+
+	senderBase = ackSeq;
+	numDuplicateACKS = 0;
+	timerStart = now;
+
+	congestion.OnAck(bytes, sample, inFlight, now);
+	DWORD window = congestion.Limit(io.MaxWindow());
+	if (window != windowSize)
+	{
+		// a failed resize keeps the old buffers and lowers MaxWindow() to them
+		io.Resize(window);
+		windowSize = congestion.Limit(io.MaxWindow());
+		Reserve(windowSize);
+	}
+
+	Publish();
+}
+
+/* Makes room for a window of 'window' packets, keeping anything still in flight. */
+TRANSPORT_TEMPLATE
+VOID TRANSPORT_CORE::Reserve(DWORD window)
+{
+	DWORD inFlight = (DWORD) (sequenceNum - senderBase);
+	DWORD needed = max(window, inFlight);
+
+	// grow to the next power of two, shrink once the window is well below capacity
+	DWORD size = 1;
+	while (size < needed && size <= MAXDWORD / 2)
+		size <<= 1;
+	if (size <= capacity && size > capacity / 4)
+		return;
+
+	Packet* resized = new Packet[size];
+	for (UINT64 seq = senderBase; seq != sequenceNum; seq++)
+		resized[seq % size] = slots[seq % capacity];
+
+	delete[] slots;
+	slots = resized;
+	capacity = size;
+}
+
+/* Asks the receiver to acknowledge only every 'ackEvery' packets or after at most
+ * 'maxDelay' microseconds. Must be called before Open(), which falls back to one
+ * ACK per packet if the receiver does not support it. */
+TRANSPORT_TEMPLATE
+VOID TRANSPORT_CORE::SetAckFrequency(DWORD ackEvery, DWORD maxDelay)
+{
+	ackFrequency.ackEvery = max(ackEvery, 1);
+	ackFrequency.maxDelay = maxDelay;
+}
+
+/* Enables low-latency mode. ACK reception spins for up to 'spinBudget' microseconds
+ * before blocking and the calling (transport) thread runs at high priority. The
+ * transport thread is pinned to 'ioCore' and the stats thread to 'statsCore', or
+ * to every other core when 'statsCore' is negative. Cores CoreMask() rejects are
+ * not pinned. */
+TRANSPORT_TEMPLATE
+VOID TRANSPORT_CORE::SetLowLatency(LONG spinBudget, INT ioCore, INT statsCore)
+{
+	io.SetSpinBudget(spinBudget);
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+	DWORD_PTR ioMask = CoreMask(ioCore);
+	if (ioMask != 0)
+		SetThreadAffinityMask(GetCurrentThread(), ioMask);
+
+	if (statsCore >= 0 || ioMask == 0)
+	{
+		PinStats(statsCore);
+		return;
+	}
+
+	// keep the stats thread away from the I/O core
+	DWORD_PTR processMask, systemMask;
+	if (stats.Thread() != NULL && GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) &&
+		(processMask & ~ioMask) != 0)
+		SetThreadAffinityMask(stats.Thread(), processMask & ~ioMask);
+}
+
+/* Pins the stats thread to 'statsCore' without enabling low-latency mode. Cores
+ * CoreMask() rejects are not pinned. */
+TRANSPORT_TEMPLATE
+VOID TRANSPORT_CORE::PinStats(INT statsCore)
+{
+	DWORD_PTR statsMask = CoreMask(statsCore);
+	if (statsMask != 0 && stats.Thread() != NULL)
+		SetThreadAffinityMask(stats.Thread(), statsMask);
+}
+
+/* Attempts to receive the acknowledgement for a SYN or FIN packet from the connected
+ * server. Uses the current RTO and store the acknowledgement the 'response' buffer.
+ * It is assumed that this buffer has already been allocated and is capacity 
+ * of at least MAX_PKT_SIZE bytes. Returns 0 to indicate success or a positive 
+ * number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::ReceiveACK(CHAR* response, DWORD packetNumber)
+{
+	INT result = -1;
+	chrono::time_point<chrono::high_resolution_clock> startTime, stopTime;
+	startTime = io.Now();
+	stopTime = startTime;
+
+	while (true)
+	{
+		LONG timeLeft = rto.Timeout() - chrono::duration_cast<chrono::microseconds>(stopTime - startTime).count();
+		// add margin of error because select operates +- 1 ms from the actual timeout value 
+		if (timeLeft < 1000)
+			break;
+
+		//printf("RCV-DEBUG: Attempting to receive ACK for packet %d, %.2fs left before retransmission\n", packetNumber, (timeLeft / 1000000.0));
+
+		// attempt to get response from server within the time left
+		result = io.Receive(response, MAX_PKT_SIZE, timeLeft);
+		if (result >= (INT) sizeof(ReceiverHeader))
+		{
+			// late data ACKs can carry the same sequence number, skip them
+			ReceiverHeader responseHeader = *(ReceiverHeader*)response;
+			if (responseHeader.ackSeq == packetNumber && (responseHeader.flags.SYN || responseHeader.flags.FIN))
+			{
+				//printf("RCV-DEBUG: Received expected setup packet %d\n", responseHeader.ackSeq);
+				return STATUS_OK;
+			}
+		}
+		else if (result == SOCKET_ERROR)
+		{
+			stopTime = io.Now();
+			printf("[%2.3f] <-- ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+			printf("failed recvfrom with %d\n", WSAGetLastError());
+			return FAILED_RECV;
+		}
+
+		stopTime = io.Now();
+	}
+
+	//cout << "RCV-DEBUG: Timeout\n";
+	stats.OnTimeout();
+	return TIMEOUT;
+}
+
+/* Sends everything queued by Write() and waits for every data packet in flight to be
+ * acknowledged. Returns 0 to indicate success or a positive number for failure. */
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::Flush()
+{
+	WORD result = STATUS_OK;
+
+	if (!connected)
+		return NOT_CONNECTED;
+
+	// refill the window every time ReceiveACKs() slides it, an empty window means nothing is left to send
+	while (true)
+	{
+		if ((result = Pump()) != STATUS_OK)
+			return result;
+		if (senderBase == sequenceNum)
+			return STATUS_OK;
+		if ((result = ReceiveACKs(TRUE)) != STATUS_OK)
+			return result;
+	}
+}
+
+/* Closes connection to the current server. Flushes data in flight, then sends a connection
+ * termination packet and waits for an acknowledgement using the RTO calculated in the call
+ * to Open(). Returns 0 to indicate success or a positive number for failure.*/
+TRANSPORT_TEMPLATE
+WORD TRANSPORT_CORE::Close(DOUBLE &elapsedTime)
+{
+	INT result = -1;
+
+	if (!connected)
+		return NOT_CONNECTED;
+
+	if ((result = Flush()) != STATUS_OK)
+		return result;
+
+	// create connection termination packet
+	SenderDataHeader termination;
+	termination.flags.FIN = 1;
+	termination.seq = (DWORD) senderBase;
+
+	CHAR* buf = new CHAR[MAX_PKT_SIZE];
+
+	chrono::time_point<chrono::high_resolution_clock> stopTime;
+
+	for (USHORT i = 1; i <= Estimator::MaxAttempts; i++)
+	{
+		// ************ SEND MESSAGE ************ //
+		//printf("FIN-DEBUG: SN %d (attempt %d of %d, RTO % .3f)\n", termination.seq, i, Estimator::MaxAttempts, (rto.Timeout() / 1000000.0));
+
+		// attempt to send the SYN packet to server
+		result = io.Send((CHAR*)&termination, sizeof(termination));
+		if (result == SOCKET_ERROR)
+		{
+			stopTime = io.Now();
+			printf("[%2.3f] --> ", chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0);
+			printf("failed sendto with %d\n", WSAGetLastError());
+			delete[] buf;
+			return FAILED_SEND;
+		}
+
+		// ********** RECEIVE RESPONSE ********** //
+		if ((result = ReceiveACK(buf, (DWORD) senderBase)) != TIMEOUT)
+		{
+			if (result == STATUS_OK)
+			{
+				ReceiverHeader responseHeader = *(ReceiverHeader*)buf;
+				stopTime = io.Now();
+				elapsedTime = chrono::duration_cast<chrono::milliseconds>(stopTime - totalTime).count() / 1000.0;
+				printf("[%2.3f] <-- ", elapsedTime);
+				printf("FIN-ACK %d window 0x%X\n", ((ReceiverHeader*)buf)->ackSeq, ((ReceiverHeader*)buf)->recvWnd);
+				connected = false;
+				delete[] buf;
+
+				// the receiver reports the checksum of what it delivered in the window field
+				if (Kernel::Enabled && responseHeader.recvWnd != ExpectedChecksum())
+				{
+					printf("[%2.3f] <-- checksum mismatch, sent 0x%X\n", elapsedTime, ExpectedChecksum());
+					return BAD_CHECKSUM;
+				}
+				return STATUS_OK;
+			}
+			else
+			{
+				delete[] buf;
+				return result;
+			}
+		}
+	}
+
+	// all attempts timed out, return
+	delete[] buf;
+	return TIMEOUT;
+}
+
+/* Checksum the receiver should report in the FIN-ACK. Multiplexed streams are checked
+ * one by one and the checksums of the streams that carried data are combined in ID order. */
+TRANSPORT_TEMPLATE
+DWORD TRANSPORT_CORE::ExpectedChecksum()
+{
+	if (!multiplexed)
+		return crc;
+
+	DWORD combined = 0;
+	for (DWORD i = 0; i < streams.size(); i++)
+	{
+		if (streams[i].nextSeq > 0)
+			combined = kernel.Update((CHAR*) &streams[i].crc, sizeof(DWORD), combined);
+	}
+
+	return combined;
+}
+
+// ******************* FACTORY ******************** //
+
+/* Creates the TransportCore for the policies chosen so far and I/O backend 'ioMode', seeding
+ * the simulation with 'simSeed'. Returns NULL if 'ioMode' is not a known backend. */
+template <class Congestion, class Estimator, class Kernel, class Sink>
+static Transport* CreateWithIO(Properties* p, DWORD ioMode, DWORD simSeed)
+{
+	switch (ioMode)
+	{
+	case IO_SELECT:
+		return new TransportCore<Congestion, Estimator, Kernel, SelectBackend, Sink>(p);
+	case IO_RIO:
+		return new TransportCore<Congestion, Estimator, Kernel, RioBackend, Sink>(p);
+	case IO_SIM:
+	{
+		TransportCore<Congestion, Estimator, Kernel, SimBackend, Sink>* sim =
+			new TransportCore<Congestion, Estimator, Kernel, SimBackend, Sink>(p);
+		sim->Backend().Seed(simSeed);
+		return sim;
+	}
+	}
+	return NULL;
+}
+
+template <class Congestion, class Estimator, class Kernel>
+static Transport* CreateWithSink(Properties* p, DWORD ioMode, DWORD policies, DWORD simSeed)
+{
+	if (policies & STATS_NONE)
+		return CreateWithIO<Congestion, Estimator, Kernel, NullStats>(p, ioMode, simSeed);
+	return CreateWithIO<Congestion, Estimator, Kernel, PropertiesStats>(p, ioMode, simSeed);
+}
+
+template <class Congestion, class Estimator>
+static Transport* CreateWithKernel(Properties* p, DWORD ioMode, DWORD policies, DWORD simSeed)
+{
+	// checksumming costs a pass over every payload on the send path, so it is opt-in
+	if (policies & CHECKSUM_CRC32)
+		return CreateWithSink<Congestion, Estimator, Crc32Kernel>(p, ioMode, policies, simSeed);
+	return CreateWithSink<Congestion, Estimator, NullChecksum>(p, ioMode, policies, simSeed);
+}
+
+template <class Congestion>
+static Transport* CreateWithEstimator(Properties* p, DWORD ioMode, DWORD policies, DWORD simSeed)
+{
+	if (policies & RTO_MICROSECOND)
+		return CreateWithKernel<Congestion, MicrosecondRto>(p, ioMode, policies, simSeed);
+	return CreateWithKernel<Congestion, JacobsonRto>(p, ioMode, policies, simSeed);
+}
+
+/* Creates the TransportCore for I/O backend 'ioMode' (IO_SELECT, IO_RIO or IO_SIM, seeded
+ * with 'simSeed') and 'policies', any of CC_TUNED, RTO_MICROSECOND, CHECKSUM_CRC32 and
+ * STATS_NONE OR'd together. Picking one policy at a time instantiates every combination
+ * here. Returns NULL if 'ioMode' is not a known backend. */
+Transport* Transport::Create(Properties* p, DWORD ioMode, DWORD policies, DWORD simSeed)
+{
+	if (policies & CC_TUNED)
+		return CreateWithEstimator<WindowTuner>(p, ioMode, policies, simSeed);
+	return CreateWithEstimator<FixedWindow>(p, ioMode, policies, simSeed);
+}
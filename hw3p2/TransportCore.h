@@ -0,0 +1,285 @@
+// TransportCore.h
+// CSCE 463-500
+// Luke Grammer
+// 11/12/19
+
+#pragma once
+
+/* Runtime interface of the RDP sender, implemented by every TransportCore. Only
+ * SenderSocket calls through it, once per API call and never per packet. */
+class Transport
+{
+public:
+	/* Constructor initializes WinSock, which the transport owns so that it outlives the
+	 * I/O backend. calls exit() if WinSock cannot be initialized. */
+	Transport();
+
+	/* Basic destructor cleans up WinSock. */
+	virtual ~Transport();
+
+	/* Initializes the I/O backend and starts the stats thread unless the backend is
+	 * simulated. Returns 0 to indicate success or SOCKET_ERROR. */
+	virtual INT Init() = 0;
+
+	/* Open() calls GetServerInfo() to populate internal server information and then creates a handshake
+	 * packet and attempts to send it to the corresponding server. If un-acknowledged, it will retransmit
+	 * this packet up to MAX_SYN_ATTEMPS times (by default 3). Open() will set the retransmission
+	 * timeout for future communication with the server to a constant scale of the handshake RTT.
+	 * Passing AUTO_WINDOW as 'senderWindow' starts from the bandwidth-delay product of the link,
+	 * the congestion control policy decides how the window changes from there.
+	 * Returns 0 to indicate success or a positive number to indicate failure. */
+	virtual WORD Open(CONST CHAR* destination, WORD port, DWORD senderWindow, STRUCT LinkProperties* lp) = 0;
+
+	/* Attempts to send a single packet to the connected server. This is the externally facing
+	 * Send() function and therefore requires a previously successful call to Open(). Up to a
+	 * window of packets are kept in flight, Send() only blocks while the window is full.
+	 * The packet goes out on stream 0 right away, ahead of anything queued by Write().
+	 * Returns INVALID_ARGUMENTS if 'messageSize' is negative or exceeds MaxPayload(),
+	 * otherwise 0 to indicate success or a positive number for failure. */
+	virtual WORD Send(CONST CHAR* message, INT messageSize) = 0;
+
+	/* Opens another stream with the given 'urgency' (0 to STREAM_MAX_URGENCY, lower is sent
+	 * first) and per-stream 'window' in packets (0 for the connection window), returning its ID
+	 * in 'streamId'. On top of it, a multiplexing receiver advertises a window per stream in its
+	 * ACKs, and the stream never has more in flight than either allows. Must be called before
+	 * Open(), which asks the receiver to deliver each stream independently. If the receiver does
+	 * not support it, only stream 0 can be written, see Write(). Returns 0 to indicate success
+	 * or a positive number for failure. */
+	virtual WORD OpenStream(DWORD& streamId, DWORD urgency = STREAM_DEFAULT_URGENCY, DWORD window = 0) = 0;
+
+	/* Queues a message of any length on stream 'streamId' and sends as much as the window
+	 * allows without blocking. The message is sent straight from 'message', which must stay
+	 * valid until Flush() or Close() returns. Streams other than 0 fail with INVALID_STREAM
+	 * unless Multiplexed() is TRUE, their data would otherwise be mixed into stream 0.
+	 * Returns 0 to indicate success or a positive number for failure. */
+	virtual WORD Write(DWORD streamId, CONST CHAR* message, UINT64 messageSize) = 0;
+
+	/* Sends everything queued by Write() and waits for every data packet in flight to be
+	 * acknowledged. Called by Close(). Returns 0 to indicate success or a positive number
+	 * for failure. */
+	virtual WORD Flush() = 0;
+
+	/* Closes connection to the current server. Waits for all data in flight to be acknowledged,
+	 * then sends a connection termination packet and waits for an acknowledgement using the RTO
+	 * calculated in the call to Open(). If the checksum kernel is enabled, the checksum in the
+	 * FIN-ACK is checked against the data sent. Returns 0 to indicate success or a positive
+	 * number for failure.*/
+	virtual WORD Close(DOUBLE& elapsedTime) = 0;
+
+	/* Asks the receiver to acknowledge only every 'ackEvery' packets or after at most
+	 * 'maxDelay' microseconds. Must be called before Open(), which falls back to one
+	 * ACK per packet if the receiver does not support it. */
+	virtual VOID SetAckFrequency(DWORD ackEvery, DWORD maxDelay) = 0;
+
+	/* Enables low-latency mode. ACK reception spins for up to 'spinBudget' microseconds
+	 * before blocking and the calling (transport) thread runs at high priority. The
+	 * transport thread is pinned to 'ioCore' and the stats thread to 'statsCore', or
+	 * to every other core when 'statsCore' is negative. Cores CoreMask() rejects are
+	 * not pinned. */
+	virtual VOID SetLowLatency(LONG spinBudget, INT ioCore, INT statsCore) = 0;
+
+	/* Pins the stats thread to 'statsCore' without enabling low-latency mode. Cores
+	 * CoreMask() rejects are not pinned. */
+	virtual VOID PinStats(INT statsCore) = 0;
+
+	/* Current time on the clock used by this transport, virtual for simulated transfers. */
+	virtual std::chrono::time_point<std::chrono::high_resolution_clock> Now() = 0;
+
+	/* Largest message Send() accepts, in bytes. Known once Open() has returned. */
+	virtual INT MaxPayload() = 0;
+
+	/* TRUE once Open() has negotiated multiplexed streams with the receiver. */
+	virtual BOOL Multiplexed() = 0;
+
+	/* Time the last packet queued on 'streamId' so far was acknowledged. */
+	virtual std::chrono::time_point<std::chrono::high_resolution_clock> StreamFinished(DWORD streamId) = 0;
+
+	/* Name of the I/O backend in use. */
+	virtual CONST CHAR* IOName() = 0;
+
+	/* Creates the TransportCore for I/O backend 'ioMode' (IO_SELECT, IO_RIO or IO_SIM, seeded
+	 * with 'simSeed') and 'policies', any of CC_TUNED, RTO_MICROSECOND, CHECKSUM_CRC32 and
+	 * STATS_NONE OR'd together. Statistics are published to 'p'. Returns NULL if 'ioMode' is
+	 * not a known backend. */
+	static Transport* Create(Properties* p, DWORD ioMode, DWORD policies, DWORD simSeed);
+
+	/* Affinity mask of logical processor 'core', or 0 if 'core' is negative, does not
+	 * fit in a DWORD_PTR or is not in the process affinity mask. */
+	static DWORD_PTR CoreMask(INT core);
+};
+
+// shorthand for the out-of-class definitions in TransportCore.cpp
+#define TRANSPORT_TEMPLATE template <class Congestion, class Estimator, class Kernel, class IO, class Sink>
+#define TRANSPORT_CORE     TransportCore<Congestion, Estimator, Kernel, IO, Sink>
+
+/* The RDP sender, built at compile time from a congestion control policy (FixedWindow
+ * or WindowTuner), an RTO estimator (JacobsonRto or MicrosecondRto), a checksum kernel
+ * (Crc32Kernel or NullChecksum), an I/O backend (SelectBackend, RioBackend or SimBackend)
+ * and a stats sink (PropertiesStats or NullStats). Policies are held by value and called
+ * on their concrete types, so the send and ACK paths contain no virtual calls. Member
+ * definitions live in TransportCore.cpp, where Transport::Create() instantiates every
+ * combination of the policies above. */
+TRANSPORT_TEMPLATE
+class TransportCore final : public Transport
+{
+	// a data packet kept until it is acknowledged
+	struct Packet
+	{
+		INT size;
+		USHORT attempts;
+		WORD stream;
+		std::chrono::time_point<std::chrono::high_resolution_clock> txTime;
+		CHAR data[MAX_PKT_SIZE];
+	};
+
+	// a message written to a stream, sent straight from the caller's buffer
+	struct Message
+	{
+		CONST CHAR* data;
+		UINT64 size;
+	};
+
+	// one multiplexed stream, all streams share the connection window
+	struct Stream
+	{
+		DWORD urgency  = STREAM_DEFAULT_URGENCY;
+		DWORD window   = 0; // sender-side cap on packets in flight, 0 for the connection window
+		DWORD receiverWindow = MAXDWORD; // last window the receiver advertised for this stream
+		DWORD inFlight = 0;
+		UINT64 nextSeq = 0; // stream sequence number of the next packet, the low 32 bits go on the wire
+		UINT64 offset  = 0; // bytes of the front message already sent
+		DWORD crc      = 0; // checksum of the stream data sent so far
+		std::deque<Message> queue;
+		std::chrono::time_point<std::chrono::high_resolution_clock> finished;
+	};
+
+	Congestion congestion;
+	Estimator rto;
+	Kernel kernel;
+	IO io;
+	Sink stats;
+
+	STRUCT sockaddr_in server;
+	STRUCT in_addr serverAddr;
+	BOOLEAN connected  = false;
+	std::chrono::time_point<std::chrono::high_resolution_clock> totalTime;
+
+	// sender state, published to the stats sink whenever it changes. Sequence numbers are kept in
+	// 64 bits and only their low 32 bits go on the wire, so they never wrap inside the transport
+	UINT64 senderBase  = 0;
+	UINT64 sequenceNum = 0; // next sequence number to send
+	DWORD windowSize   = 0;
+
+	// packets in flight, indexed by sequence number modulo capacity
+	Packet* slots          = NULL;
+	DWORD capacity         = 0;
+	DWORD receiverWindow   = 1;
+	SHORT numDuplicateACKS = 0;
+	CHAR response[MAX_PKT_SIZE];
+	std::chrono::time_point<std::chrono::high_resolution_clock> timerStart; // RTO timer for senderBase
+
+	// ACK coalescing, requested before Open() and enabled if the receiver agrees
+	AckFrequency ackFrequency;
+	BOOLEAN delayedACKs = false;
+
+	// stream 0 always exists, more are requested before Open() and used if the receiver agrees
+	std::vector<Stream> streams = std::vector<Stream>(1);
+	DWORD nextStream    = 0; // round robin position
+	BOOLEAN multiplexed = false;
+	DWORD crc           = 0; // checksum of the data sent in sequence order
+
+	/* GetServerInfo does a forward lookup on the destination host string if necessary
+	 * and populates it's internal server information with the result. Called in Open().
+	 * Simulated transfers accept any host without a lookup. Returns code 0 to indicate
+	 * success or 3 if the target hostname does not have an entry in DNS. */
+	WORD GetServerInfo(CONST CHAR* destination, WORD port);
+
+	/* Attempts to receive the acknowledgement for a SYN or FIN packet from the connected
+	 * server. Uses the current RTO and store the acknowledgement the 'response' buffer.
+	 * It is assumed that this buffer has already been allocated and is capacity
+	 * of at least MAX_PKT_SIZE bytes. Returns 0 to indicate success or a positive
+	 * number for failure. */
+	WORD ReceiveACK(CHAR* response, DWORD packetNumber);
+
+	/* Handles acknowledgements for data packets in flight, retransmitting senderBase on
+	 * timeout or after Congestion::FastRetxThreshold duplicate ACKs. If 'block' is TRUE,
+	 * waits until senderBase advances, otherwise only consumes ACKs that have already
+	 * arrived. Returns 0 to indicate success or a positive number for failure. */
+	WORD ReceiveACKs(BOOL block);
+
+	/* Slides the window up to 'ackSeq', taking an RTT sample from the newest packet
+	 * it acknowledges with the receiver's 'ackDelay' (in microseconds) removed, unless
+	 * the ACK covers a retransmitted packet. */
+	VOID AdvanceWindow(UINT64 ackSeq, DWORD ackDelay, std::chrono::time_point<std::chrono::high_resolution_clock> now);
+
+	/* (Re)transmits the packet with sequence number 'seq'. Returns 0 to indicate
+	 * success or a positive number for failure. */
+	WORD Transmit(UINT64 seq);
+
+	/* Makes room for a window of 'window' packets, keeping anything still in flight. */
+	VOID Reserve(DWORD window);
+
+	/* Fills in the slot for sequence number 'seq' with the next packet of stream 'streamId'. */
+	VOID Frame(UINT64 seq, WORD streamId, CONST CHAR* message, INT messageSize);
+
+	/* Picks the stream to send from next: the lowest urgency with data queued and room in its
+	 * window, round robin between streams of the same urgency. Returns -1 if there is none. */
+	INT NextStream();
+
+	/* Transmits queued stream data until the window is full or nothing is left to send.
+	 * Returns 0 to indicate success or a positive number for failure. */
+	WORD Pump();
+
+	/* Checksum the receiver should report in the FIN-ACK. */
+	DWORD ExpectedChecksum();
+
+	/* Serial number arithmetic (RFC 1982) for a 32-bit sequence number from the wire: the
+	 * 64-bit sequence number with the same low 32 bits that is closest to senderBase. Exact
+	 * while the window stays below 2^31 packets, an ACK from before the SYN comes out past
+	 * sequenceNum and is ignored. */
+	UINT64 Unwrap(DWORD seq) { return senderBase + (LONG) (seq - (DWORD) senderBase); }
+
+	/* Packets allowed in flight, the sender window limited by the receiver window. */
+	DWORD Window() { return min(windowSize, receiverWindow); }
+
+	/* Packets 'stream' may have in flight, never more than the connection window or the
+	 * window the receiver advertised for the stream. */
+	DWORD StreamWindow(CONST Stream& stream)
+	{
+		DWORD window = min(stream.receiverWindow, Window());
+		return (stream.window > 0) ? min(stream.window, window) : window;
+	}
+
+	INT HeaderSize() { return multiplexed ? sizeof(SenderStreamHeader) : sizeof(SenderDataHeader); }
+
+	/* Publishes the window state to the stats sink. */
+	VOID Publish() { stats.OnWindow(senderBase, sequenceNum, windowSize); }
+
+public:
+	/* Constructor sets up the server address, the I/O backend is not touched until Init().
+	 * The stats sink publishes to 'p'. */
+	TransportCore(Properties* p);
+
+	/* Basic destructor cleans up the packet slots, the policies clean up after themselves. */
+	~TransportCore();
+
+	INT Init();
+	WORD Open(CONST CHAR* destination, WORD port, DWORD senderWindow, STRUCT LinkProperties* lp);
+	WORD Send(CONST CHAR* message, INT messageSize);
+	WORD OpenStream(DWORD& streamId, DWORD urgency = STREAM_DEFAULT_URGENCY, DWORD window = 0);
+	WORD Write(DWORD streamId, CONST CHAR* message, UINT64 messageSize);
+	WORD Flush();
+	WORD Close(DOUBLE& elapsedTime);
+	VOID SetAckFrequency(DWORD ackEvery, DWORD maxDelay);
+	VOID SetLowLatency(LONG spinBudget, INT ioCore, INT statsCore);
+	VOID PinStats(INT statsCore);
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> Now() { return io.Now(); }
+	INT MaxPayload() { return MAX_PKT_SIZE - HeaderSize(); }
+	BOOL Multiplexed() { return multiplexed; }
+	std::chrono::time_point<std::chrono::high_resolution_clock> StreamFinished(DWORD streamId) { return streams[streamId].finished; }
+	CONST CHAR* IOName() { return io.Name(); }
+
+	/* The I/O backend, for setup specific to one backend such as the simulation seed. */
+	IO& Backend() { return io; }
+};
@@ -0,0 +1,86 @@
+// WindowTuner.cpp
+// CSCE 463-500
+// Luke Grammer
+// 11/12/19
+
+#include "pch.h"
+
+using namespace std;
+
+DWORD WindowTuner::LinkWindow(FLOAT speed, FLOAT rtt)
+{
+	DOUBLE packets = ceil(speed * rtt / (8.0 * MAX_PKT_SIZE));
+	return (DWORD) max(TUNER_MIN_WINDOW, min(TUNER_MAX_WINDOW, packets));
+}
+
+DWORD WindowTuner::Start(DWORD senderWindow, FLOAT speed, FLOAT rtt)
+{
+	linkSpeed = speed;
+	window = (senderWindow == AUTO_WINDOW) ? LinkWindow(speed, rtt) : senderWindow;
+	return window;
+}
+
+DWORD WindowTuner::Init(DWORD rtt, DWORD receiverWindow, chrono::time_point<chrono::high_resolution_clock> now)
+{
+	btlBw = linkSpeed / 8.0;
+	minRTT = max(rtt, 1);
+	smoothedRTT = minRTT;
+	maxWindow = max(receiverWindow, TUNER_MIN_WINDOW);
+
+	sampleStart = now;
+	sampleBytes = 0;
+	sampleFull = false;
+
+	Update();
+	return window;
+}
+
+DWORD WindowTuner::OnAck(DWORD bytes, DWORD rtt, DWORD inFlight, chrono::time_point<chrono::high_resolution_clock> now)
+{
+	if (rtt > 0)
+	{
+		minRTT = min(minRTT, rtt);
+		smoothedRTT = (DWORD) (.875 * smoothedRTT + .125 * rtt);
+	}
+
+	sampleBytes += bytes;
+	if (inFlight >= window)
+		sampleFull = true;
+
+	// take a delivery rate sample roughly once per round trip
+	UINT64 elapsed = chrono::duration_cast<chrono::microseconds>(now - sampleStart).count();
+	if (elapsed >= minRTT && elapsed > 0)
+	{
+		DOUBLE rate = sampleBytes * 1000000.0 / elapsed;
+		if (rate > btlBw)
+			btlBw = rate;
+		else if (sampleFull)
+			btlBw = .875 * btlBw + .125 * rate;
+
+		sampleStart = now;
+		sampleBytes = 0;
+		sampleFull = false;
+	}
+
+	Update();
+	return window;
+}
+
+DWORD WindowTuner::Limit(DWORD packets)
+{
+	ioLimit = max(packets, TUNER_MIN_WINDOW);
+	window = min(window, ioLimit);
+	return window;
+}
+
+VOID WindowTuner::Update()
+{
+	DOUBLE bdp = btlBw * minRTT / (1000000.0 * MAX_PKT_SIZE);
+
+	// drain the router queue while RTT is well above the propagation delay
+	DOUBLE gain = (smoothedRTT > minRTT + minRTT / 2) ? 1.0 : TUNER_GAIN;
+
+	DOUBLE packets = ceil(gain * bdp);
+	DWORD limit = min(maxWindow, ioLimit);
+	window = (DWORD) max(TUNER_MIN_WINDOW, min((DOUBLE) limit, packets));
+}
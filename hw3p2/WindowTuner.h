@@ -0,0 +1,62 @@
+// WindowTuner.h
+// CSCE 463-500
+// Luke Grammer
+// 11/12/19
+
+#pragma once
+
+/* WindowTuner sizes the sender window from an estimate of the bandwidth-delay
+ * product. The bottleneck bandwidth starts at the configured link speed and is
+ * raised by measured delivery rates. It is only lowered by samples taken while
+ * the window was full, because an application-limited sender says nothing about
+ * the path. The window targets TUNER_GAIN times the BDP and falls back to the
+ * plain BDP while queueing delay is building up. This is the adaptive congestion
+ * control policy of TransportCore, FixedWindow in Policies.h is the other one. */
+class WindowTuner
+{
+	FLOAT linkSpeed    = 0;        // configured link speed (bits/sec)
+	DOUBLE btlBw       = 0;        // bottleneck bandwidth estimate (bytes/sec)
+	DWORD minRTT       = MAXDWORD; // propagation delay estimate (microseconds)
+	DWORD smoothedRTT  = 0;        // microseconds
+	DWORD window       = 1;        // packets
+	DWORD maxWindow    = 1;        // receiver window from the handshake
+	DWORD ioLimit      = MAXDWORD; // packets the I/O backend can keep in flight
+
+	// current delivery rate sample
+	std::chrono::time_point<std::chrono::high_resolution_clock> sampleStart;
+	UINT64 sampleBytes = 0;
+	BOOLEAN sampleFull = false;
+
+	/* Recomputes the window from the current estimates. */
+	VOID Update();
+
+public:
+	// duplicate ACKs that trigger a fast retransmit
+	static CONST DWORD FastRetxThreshold = FAST_RTX_NUM;
+
+	/* Window used for the handshake, before any RTT has been measured. 'senderWindow' is the
+	 * window requested in Open(), AUTO_WINDOW to size it from the link speed (bits/sec) and
+	 * the configured 'rtt' (seconds). Returns the window in packets. */
+	DWORD Start(DWORD senderWindow, FLOAT speed, FLOAT rtt);
+
+	/* Starts tuning from the link speed and the handshake RTT (microseconds). The window is
+	 * never allowed to exceed 'receiverWindow'. 'now' is the current time on the transport's
+	 * clock. Returns the initial window. */
+	DWORD Init(DWORD rtt, DWORD receiverWindow, std::chrono::time_point<std::chrono::high_resolution_clock> now);
+
+	/* Accounts for 'bytes' newly acknowledged at 'now' with 'inFlight' packets outstanding
+	 * when the ACK arrived. 'rtt' is a microsecond RTT sample or 0 if the ACK was for a
+	 * retransmission. Returns the new window. */
+	DWORD OnAck(DWORD bytes, DWORD rtt, DWORD inFlight, std::chrono::time_point<std::chrono::high_resolution_clock> now);
+
+	/* Caps the window at the 'packets' the I/O backend can keep in flight, so the tuner
+	 * judges a full window against what the transport actually sends. Returns the new
+	 * window. */
+	DWORD Limit(DWORD packets);
+
+	DWORD Window() { return window; }
+
+	/* Window (in packets) of the bandwidth-delay product of a link, used before any
+	 * RTT has been measured. */
+	static DWORD LinkWindow(FLOAT speed, FLOAT rtt);
+};
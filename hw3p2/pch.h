@@ -7,17 +7,31 @@
 #ifndef PCH_H
 #define PCH_H
 
+#define _WINSOCK_DEPRECATED_NO_WARNINGS // inet_addr() and gethostbyname()
+
+#include <winsock2.h>
+#include <mswsock.h>
 #include <windows.h>
 
 #include <iostream>
 #include <chrono>
 #include <cassert>
+#include <random>
+#include <queue>
+#include <deque>
+#include <map>
+#include <vector>
+#include <functional>
 
 #include "Constants.h"
 #include "Headers.h"
 #include "StatsManager.h"
-#include "SenderSocket.h"
 #include "Checksum.h"
+#include "IOBackend.h"
+#include "WindowTuner.h"
+#include "Policies.h"
+#include "TransportCore.h"
+#include "SenderSocket.h"
 
 #define _CRTDBG_MAP_ALLOC  
 #include <stdlib.h>  